@@ -11,6 +11,8 @@
 #ifndef N64Controller_h
 #define N64Controller_h
 
+#include <stdint.h>
+
 #define N64_PIN     10
 #define N64_PIN_DIR DDRB
 
@@ -34,20 +36,19 @@ typedef struct state
     unsigned char data2;
 } N64_status_packet;
 
+#define N64_GET_STATUS          0x01
+
 class N64Controller 
 {
   public:  
     N64Controller();
     void N64_init();
-    void translate_N64_data();
     void N64_get_data_from_controller();
-    void N64_send_data_request(unsigned char *buffer, char length);
+    uint8_t N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength);
     void print_N64_status();
     void getN64Packet();
     N64_status_packet N64_status;
-
-  private:
-    char N64_raw_dump[33]; // 1 received bit per byte
+    uint8_t replyBits; // Bits of the last status reply, 32 when complete
 };
 
 #endif
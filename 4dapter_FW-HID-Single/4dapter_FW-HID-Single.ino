@@ -21,6 +21,8 @@
  #include "SegaController32U4.h"
  #include "Gamepad.h"
  #include "N64_Controller.h"
+ #include "N64Stick.h"
+ #include "NESSNES_Scanner.h"
  
  // ATT: 20 chars max (including NULL at the end) according to Arduino source code.
  // Additionally serial number is used to differentiate arduino projects to have different button maps!
@@ -28,7 +30,7 @@
  
  #define N64Mister       false  // 'true' to map N64 C-Buttons to align with SNES, 'false' to set C-Button to their own inputs
  #define N64MapJoyToMax  true   // 'true' to map value to DInput Max (-128 to +127), set to false to use controller value directly
- #define N64JoyMax       80     // N64 Joystick Maximum Travel Range (0-127, typically between 75-85 on OEM controllers)
+ #define N64JoyMax       80     // N64 Joystick Maximum Travel Range until learned (0-127, typically between 75-85 on OEM controllers)
  #define N64JoyDeadzone  3      // Deadzone to return 0, minimizes drift
  
  N64Controller       n64_controller;
@@ -36,23 +38,8 @@
  int8_t LeftX = 0;
  int8_t LeftY = 0;
  
- #define NES       0
- #define SNES      1
  #define GENESIS   2
  
- #define BUTTONS   0
- #define AXES      1
- 
- #define UP        0x01
- #define DOWN      0x02
- #define LEFT      0x04
- #define RIGHT     0x08
- 
- #define NTT_BIT   0x00
- #define NODATA    0x00
- 
- void sendLatch();
- void sendClock();
  void sendState();
  
  // Controller DB9 pins (looking face-on to the end of the plug):
@@ -125,90 +112,26 @@
  
  // Manage EEPROM by making sure everything has
  // its own index.
- enum EEPROMIndices { GENESIS_EEPROM };
+ // N64_STICK_EEPROM takes N64_STICK_EEPROM_SIZE bytes.
+ enum EEPROMIndices { GENESIS_EEPROM, N64_STICK_EEPROM };
  
  // Set up USB HID gamepads
  Gamepad_ Gamepad;
  
  SegaController32U4 controller(GENESIS_EEPROM);
  
+ // N64 stick conversion and travel calibration, see N64Stick.h
+ N64Stick n64Stick(N64_STICK_EEPROM, N64_STICK_SIGNED, true, N64JoyMax, N64JoyDeadzone, N64MapJoyToMax);
+ 
  // Controllers
+ NESSNESScanner scanner;
  uint32_t  controllerData[2][2] = {{0,0},{0,0}};
- uint32_t  axisIndicator[32] = {0,0,0,0,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
  uint32_t  currentState = 0;
  
  uint32_t  n64Buttons = 0;
    int8_t  n64X;
    int8_t  n64Y;
  
- bool      nttActive = false;
- 
- uint32_t  dataMaskNES[8] =        {0x02,   // A
-                                    0x01,   // B
-                                    0x40,   // Start 
-                                    0x80,   // Select
-                                    UP,     // D-Up
-                                    DOWN,   // D-Down
-                                    LEFT,   // D-Left
-                                    RIGHT   // D-Right
-                                    }; 
- 
- // Power Pad D4
- uint32_t  dataMaskPowerPadD4[8] = {0x08,    // PowerPad #4
-                                    0x04,    // PowerPad #3
-                                    0x800,   // PowerPad #12
-                                    0x80,    // PowerPad #8
-                                    NODATA,  // No Data
-                                    NODATA,  // No Data
-                                    NODATA,  // No Data
-                                    NODATA   // No Data
-                                    }; 
- 
- // Power Pad D3
- uint32_t  dataMaskPowerPadD3[8] = {0x02,   // PowerPad #2
-                                    0x01,   // PowerPad #1
-                                    0x10,   // PowerPad #5
-                                    0x100,  // PowerPad #9
-                                    0x20,   // PowerPad #6
-                                    0x200,  // PowerPad #10
-                                    0x400,  // PowerPad #11
-                                    0x40    // PowerPad #7
-                                    }; 
- 
- uint32_t  dataMaskSNES[32] =      {0x01,    // B
-                                    0x04,    // Y
-                                    0x40,    // Start   
-                                    0x80,    // Select
-                                    UP,      // D-Up
-                                    DOWN,    // D-Down
-                                    LEFT,    // D-Left
-                                    RIGHT,   // D-Right
-                                    0x02,    // A
-                                    0x08,    // X
-                                    0x10,    // L
-                                    0x20,    // R
-                                    NODATA,  // SNES Control Bit
-                                    NTT_BIT, // NTT Indicator Bit
-                                    NODATA,  // SNES Control Bit
-                                    NODATA,  // SNES Control Bit
-                                    0x100,   // NTT 0
-                                    0x200,   // NTT 1
-                                    0x400,   // NTT 2
-                                    0x800,   // NTT 3
-                                    0x1000,  // NTT 4
-                                    0x2000,  // NTT 5
-                                    0x4000,  // NTT 6
-                                    0x8000,  // NTT 7
-                                    0x10000, // NTT 8
-                                    0x20000, // NTT 9
-                                    0x40000, // NTT *
-                                    0x80000, // NTT #
-                                    0x100000,// NTT .
-                                    0x200000,// NTT C
-                                    NODATA,  // NTT No Data
-                                    0x800000,// NTT End Comms
-                                    };
- 
  void setup()
  {
    n64_controller.N64_init();
@@ -240,78 +163,22 @@
  { 
    while(true)
    {
-     //8 cycles needed to capture 6-button controllers
+     //8 cycles needed to capture 6-button controllers, the select line settle
+     //time of each one is spent clocking the NES/SNES bus
+     scanner.begin();
      for(uint8_t i = 0; i < 8; i++)
      {
-       currentState = controller.updateState();
+       controller.toggleSelect();
+       scanner.stepFor(SC_CYCLE_DELAY);
+       currentState = controller.readState();
      }
  
      currentState = controller.getFinalState();
  
      for(uint8_t j = 0; j < 1; j++)
      {
-       sendLatch();
- 
-       controllerData[NES][BUTTONS] = 0;
-       controllerData[NES][AXES] = 0;
-       
-       controllerData[SNES][BUTTONS] = 0;
-       controllerData[SNES][AXES] = 0;
- 
-       nttActive = false;
-   
-       for(uint8_t dataBitCounter = 0; dataBitCounter < 32; dataBitCounter++)
-       {
-         // If no NTT controller, end the loop early
-         if(!nttActive && dataBitCounter > 13)
-         {
-           break;
-         }
- 
-         //NES Power Pad Controller
-         if((dataBitCounter < 8) && ((PINB & B00100000) == 0)) //Power Pad Pin D4 (bottom)
-         { 
-           controllerData[NES][BUTTONS] |= dataMaskPowerPadD4[dataBitCounter];
-         }
- 
-         if((dataBitCounter < 8) && ((PINB & B00010000) == 0)) //Power Pad Pin D3 (middle)
-         { 
-           controllerData[NES][BUTTONS] |= dataMaskPowerPadD3[dataBitCounter];
-         }
- 
-         // NES Controller
-         if((dataBitCounter < 8) && ((PINF & B10000000) == 0)) //If NES data line is low (indicating a press)
-         { 
-           if(axisIndicator[dataBitCounter])
-           {
-             controllerData[NES][AXES] |= dataMaskNES[dataBitCounter];
-           }
-           else
-           {
-             controllerData[NES][BUTTONS] |= dataMaskNES[dataBitCounter];
-           }
-         }
- 
-         // SNES / NTT Controller 
-         if((PINF & B01000000) == 0) //If SNES data line is low (indicating a press)
-         {
-           if(dataBitCounter == 13)
-           {
-             nttActive = true;
-           }
-           
-           if(axisIndicator[dataBitCounter])
-           {
-             controllerData[SNES][AXES] |= dataMaskSNES[dataBitCounter];
-           }
-           else
-           {
-             controllerData[SNES][BUTTONS] |= dataMaskSNES[dataBitCounter];
-           }
-         }
-         
-         sendClock();
-       }
+       while(scanner.step());
+       scanner.finish(controllerData);
        
        n64_controller.getN64Packet();
        N64Data = n64_controller.N64_status;
@@ -320,41 +187,9 @@
        n64Y = 0;
        n64Buttons = 0;
        
-       if(N64Data.stick_x >= -N64JoyDeadzone && N64Data.stick_x <= N64JoyDeadzone)
-       {
-         LeftX = 0;
-       }
-       else
-       {
-         if(N64MapJoyToMax)
-         {
-           if(N64Data.stick_x > N64JoyMax)   N64Data.stick_x = N64JoyMax;
-           if(N64Data.stick_x < -N64JoyMax)  N64Data.stick_x = -N64JoyMax;
-           LeftX = map(N64Data.stick_x, -N64JoyMax, N64JoyMax, -128, 127);
-         }
-         else
-         {
-           LeftX = (int8_t)N64Data.stick_x;
-         }
-       }
- 
-       if(N64Data.stick_y >= -N64JoyDeadzone && N64Data.stick_y <= N64JoyDeadzone)
-       {
-         LeftY = 0;
-       }
-       else
-       {
-         if(N64MapJoyToMax)
-         {
-           if(N64Data.stick_y > N64JoyMax)   N64Data.stick_y = N64JoyMax;
-           if(N64Data.stick_y < -N64JoyMax)  N64Data.stick_y = -N64JoyMax;
-           LeftY = map(-N64Data.stick_y, -N64JoyMax, N64JoyMax, -128, 127); 
-         }
-         else
-         {
-           LeftY = (int8_t) -N64Data.stick_y;
-         }
-       } 
+       n64Stick.update(N64Data);
+       LeftX = (int8_t)n64Stick.x(N64Data.stick_x);
+       LeftY = (int8_t)n64Stick.y(N64Data.stick_y);
  
  
        if(N64Mister == true)
@@ -421,24 +256,6 @@
   }
  }
  
- void sendLatch()
- {
-   // Send a latch pulse to NES/SNES
-   PORTD |=  B00000010; // Set HIGH
-   __builtin_avr_delay_cycles(192);
-   PORTD &= ~B00000010; // Set LOW
-   __builtin_avr_delay_cycles(72);
- }
- 
- void sendClock()
- {
-   // Send a clock pulse to NES/SNES
-   PORTD |=  B00000001; // Set HIGH
-   __builtin_avr_delay_cycles(96);
-   PORTD &= ~B00000001; // Set LOW
-   __builtin_avr_delay_cycles(72);
- }
- 
  void sendState()
  {
    Gamepad.send();
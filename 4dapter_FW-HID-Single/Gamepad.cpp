@@ -25,6 +25,12 @@
  */
 #include "Gamepad.h"
 
+// The core sets up all 64 byte endpoints double banked (EP_DOUBLE_64), which
+// writeEndpoint() relies on
+#if USB_EP_SIZE != 64
+#error "Gamepad_ needs double banked 64 byte endpoints"
+#endif
+
 static const uint8_t _hidReportDescriptor[] PROGMEM = {
   0x05, 0x01,                       // USAGE_PAGE (Generic Desktop)
   0x09, 0x04,                       // USAGE (Joystick) (Maybe change to gamepad? I don't think so but...)
@@ -57,7 +63,7 @@ static const uint8_t _hidReportDescriptor[] PROGMEM = {
   0xc0,                             // END_COLLECTION 
 };
 
-Gamepad_::Gamepad_(void) : PluggableUSBModule(1, 1, epType), protocol(HID_REPORT_PROTOCOL), idle(1)
+Gamepad_::Gamepad_(void) : PluggableUSBModule(1, 1, epType), protocol(HID_REPORT_PROTOCOL), idle(1), _lastReportTime(0)
 {
   epType[0] = EP_TYPE_INTERRUPT_IN;
   PluggableUSB().plug(this);
@@ -102,11 +108,16 @@ bool Gamepad_::setup(USBSetup& setup)
   if (requestType == REQUEST_DEVICETOHOST_CLASS_INTERFACE)
   {
     if (request == HID_GET_REPORT) {
-      // TODO: HID_GetReport();
+      if (setup.wValueH != HID_REPORT_TYPE_INPUT) { return false; }
+      USB_SendControl(0, &_lastReport, sizeof(GamepadReport));
+      return true;
+    }
+    if (request == HID_GET_IDLE) {
+      USB_SendControl(0, &idle, 1);
       return true;
     }
     if (request == HID_GET_PROTOCOL) {
-      // TODO: Send8(protocol);
+      USB_SendControl(0, &protocol, 1);
       return true;
     }
   }
@@ -118,7 +129,8 @@ bool Gamepad_::setup(USBSetup& setup)
       return true;
     }
     if (request == HID_SET_IDLE) {
-      idle = setup.wValueL;
+      // Duration in 4ms units is the high byte, the low byte is the report ID
+      idle = setup.wValueH;
       return true;
     }
     if (request == HID_SET_REPORT)
@@ -139,7 +151,55 @@ void Gamepad_::reset()
 
 void Gamepad_::send() 
 {
-  USB_Send(pluggedEndpoint | TRANSFER_RELEASE, &_GamepadReport, sizeof(GamepadReport));
+  unsigned long now = millis();
+
+  // Idle rate 0 means the report is only sent on change
+  bool idleExpired = (idle != 0) && (now - _lastReportTime >= (unsigned long)idle * 4);
+
+  if (!idleExpired && memcmp(&_GamepadReport, &_lastReport, sizeof(GamepadReport)) == 0)
+    return;
+
+  // Keep the old report if the device is not configured, so the change is retried
+  if (!writeEndpoint(&_GamepadReport, sizeof(GamepadReport)))
+    return;
+
+  // GET_REPORT reads the cache from the USB interrupt
+  uint8_t sreg = SREG;
+  cli();
+  _lastReport = _GamepadReport;
+  SREG = sreg;
+
+  _lastReportTime = now;
+}
+
+// Unlike USB_Send() this never waits for the host. Reports the host did not
+// fetch yet are killed, so only the newest one is pending (drop-oldest) and an
+// interface that is never polled can't stall the scan loop.
+bool Gamepad_::writeEndpoint(const void* data, uint8_t len)
+{
+  if (!USBDevice.configured())
+    return false;
+
+  // The USB interrupt changes UENUM without restoring it
+  uint8_t sreg = SREG;
+  cli();
+
+  UENUM = pluggedEndpoint;
+
+  while (UESTA0X & ((1 << NBUSYBK1) | (1 << NBUSYBK0)))
+  {
+    UEINTX |= (1 << KILLBK);
+    while (UEINTX & (1 << KILLBK));
+  }
+
+  const uint8_t* d = (const uint8_t*)data;
+  while (len--)
+    UEDATX = *d++;
+
+  UEINTX = 0x3A; // Release the bank (FIFOCON=0, TXINI=0), same as the core's ReleaseTX()
+
+  SREG = sreg;
+  return true;
 }
 
 uint8_t Gamepad_::getShortName(char *name)
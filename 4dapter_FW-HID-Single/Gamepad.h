@@ -47,14 +47,18 @@ class Gamepad_ : public PluggableUSBModule
     int getDescriptor(USBSetup& setup);
     uint8_t getShortName(char *name);
     bool setup(USBSetup& setup);
+    bool writeEndpoint(const void* data, uint8_t len);
     
     uint8_t epType[1];
     uint8_t protocol;
     uint8_t idle;
+
+    GamepadReport _lastReport;      // Last report handed to the host
+    unsigned long _lastReportTime;
     
   public:
     GamepadReport _GamepadReport;
     Gamepad_(void);
     void reset(void);
-    void send();
+    void send();  // Only transmits on change or when the idle period expired
 };
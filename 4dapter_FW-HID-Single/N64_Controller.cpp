@@ -13,7 +13,8 @@
 
 N64Controller::N64Controller()
 {
-  
+  memset(&N64_status, 0, sizeof(N64_status));
+  replyBits = 0;
 }
 
 void N64Controller::N64_init()
@@ -23,43 +24,20 @@ void N64Controller::N64_init()
   pinMode(N64_PIN, INPUT);
 }
 
-void N64Controller::translate_N64_data()
-{
-    memset(&N64_status, 0, sizeof(N64_status));
-    
-    // line 1
-    // bits: A, B, Z, Start, Dup, Ddown, Dleft, Dright
-    // line 2
-    // bits: Reset, 0, L, R, Cup, Cdown, Cleft, Cright
-    // line 3
-    // bits: joystick x value
-    // These are 8 bit values centered at 0x80 (128)
-    // line 4
-    // bits: joystick 4 value
-    // These are 8 bit values centered at 0x80 (128)
-    
-    for (int i=0; i<8; i++) 
-    {
-        N64_status.data1 |= N64_raw_dump[i] ? (0x80 >> i) : 0;
-        N64_status.data2 |= N64_raw_dump[8+i] ? (0x80 >> i) : 0;
-        N64_status.stick_x |= N64_raw_dump[16+i] ? (0x80 >> i) : 0;
-        N64_status.stick_y |= N64_raw_dump[24+i] ? (0x80 >> i) : 0;
-    }
-}
-
-
 /**
- * This sends the given byte sequence to the controller
+ * This sends the given byte sequence to the controller and shifts the reply
+ * straight into 'reply', up to 'replyLength' bytes
  * length must be at least 1
  * Oh, it destroys the buffer passed in as it writes it
+ * Returns the number of reply bits received, a trailing partial byte is not
+ * stored
  */
-void N64Controller::N64_send_data_request(unsigned char *buffer, char length)
+uint8_t N64Controller::N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength)
 {
     char bits;
-    bool bit;
     unsigned char timeout;
-    char bitcount = 32;
-    char *bitbin = N64_raw_dump;
+    unsigned char data = 0;
+    uint8_t received = 0;
 
 
   outer_loop:
@@ -109,14 +87,14 @@ void N64Controller::N64_send_data_request(unsigned char *buffer, char length)
     N64_HIGH;
 
     //////////////////////
-    // listen for the expected 8 bytes of data back from the controller and
-    // blast it out to the N64_raw_dump array, one bit per byte for extra speed.
+    // listen for the reply, every bit is shifted into 'data' as it arrives
+    // and stored once its byte is complete
 
     timeout = 0x7f;
     while (!N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
 
 read_loop:
@@ -126,18 +104,21 @@ read_loop:
     while (N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
 
     //Wait 2us before reading data
     __builtin_avr_delay_cycles(32);
    
-    *bitbin = N64_QUERY;
-    ++bitbin;
-    --bitcount;
+    data = (data << 1) | (N64_QUERY ? 1 : 0);
+    ++received;
     
-    if (bitcount == 0)
-        return;
+    if ((received & 7) == 0)
+    {
+        *reply++ = data;
+        if (--replyLength == 0)
+            return received;
+    }
 
     // wait for line to go high again
     // it may already be high, so this should just drop through
@@ -145,7 +126,7 @@ read_loop:
     while (!N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
     
     goto read_loop;
@@ -153,9 +134,38 @@ read_loop:
 
 void N64Controller::getN64Packet()
 {
-    unsigned char N64Command[] = {0x01};
-    noInterrupts();
-    N64_send_data_request(N64Command, 1);
-    interrupts();
-    translate_N64_data();
+    // reply bytes:
+    // 1: A, B, Z, Start, Dup, Ddown, Dleft, Dright
+    // 2: Reset, 0, L, R, Cup, Cdown, Cleft, Cright
+    // 3: joystick x value
+    // 4: joystick y value
+    // The joystick values are signed 8 bit, centered at 0
+    unsigned char reply[4];
+
+    // A short or invalid reply (noisy cable, loose plug) is retried once,
+    // after that the last good state is kept. No reply at all means no
+    // controller, which releases everything.
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        unsigned char N64Command[] = {N64_GET_STATUS};
+        noInterrupts();
+        replyBits = N64_send_data_request(N64Command, 1, reply, sizeof(reply));
+        interrupts();
+
+        if (replyBits == 0)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            return;
+        }
+
+        // bit 6 of the second byte is always 0
+        if (replyBits == 32 && !(reply[1] & 0x40))
+        {
+            N64_status.data1   = reply[0];
+            N64_status.data2   = reply[1];
+            N64_status.stick_x = reply[2];
+            N64_status.stick_y = reply[3];
+            return;
+        }
+    }
 }
@@ -0,0 +1,254 @@
+/*  NESSNES_Scanner.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <avr/pgmspace.h>
+#include <util/delay_basic.h>
+
+#include "NESSNES_Scanner.h"
+
+// Button words indexed by 4 consecutive bits of a plane (first bit shifted out = bit 0)
+
+// A, B, Start, Select
+static const uint8_t nesButtons[16] PROGMEM =
+  { 0x00, 0x02, 0x01, 0x03, 0x40, 0x42, 0x41, 0x43,
+    0x80, 0x82, 0x81, 0x83, 0xC0, 0xC2, 0xC1, 0xC3 };
+
+// B, Y, Start, Select
+static const uint8_t snesButtonsLow[16] PROGMEM =
+  { 0x00, 0x01, 0x04, 0x05, 0x40, 0x41, 0x44, 0x45,
+    0x80, 0x81, 0x84, 0x85, 0xC0, 0xC1, 0xC4, 0xC5 };
+
+// A, X, L, R
+static const uint8_t snesButtonsHigh[16] PROGMEM =
+  { 0x00, 0x02, 0x08, 0x0A, 0x10, 0x12, 0x18, 0x1A,
+    0x20, 0x22, 0x28, 0x2A, 0x30, 0x32, 0x38, 0x3A };
+
+// Power Pad D4: #4, #3, #12, #8
+static const uint16_t powerPadD4[16] PROGMEM =
+  { 0x000, 0x008, 0x004, 0x00C, 0x800, 0x808, 0x804, 0x80C,
+    0x080, 0x088, 0x084, 0x08C, 0x880, 0x888, 0x884, 0x88C };
+
+// Power Pad D3: #2, #1, #5, #9
+static const uint16_t powerPadD3Low[16] PROGMEM =
+  { 0x000, 0x002, 0x001, 0x003, 0x010, 0x012, 0x011, 0x013,
+    0x100, 0x102, 0x101, 0x103, 0x110, 0x112, 0x111, 0x113 };
+
+// Power Pad D3: #6, #10, #11, #7
+static const uint16_t powerPadD3High[16] PROGMEM =
+  { 0x000, 0x020, 0x200, 0x220, 0x400, 0x420, 0x600, 0x620,
+    0x040, 0x060, 0x240, 0x260, 0x440, 0x460, 0x640, 0x660 };
+
+// Collects one data line out of 8 samples, bit n set if the line was low (pressed) on clock n
+static uint8_t gatherPlane(const uint8_t *samples, uint8_t mask)
+{
+  uint8_t plane = 0;
+
+  samples += 8;
+  for(uint8_t i = 0; i < 8; i++)
+  {
+    plane <<= 1;
+    if((*--samples & mask) == 0)
+      plane |= 1;
+  }
+
+  return plane;
+}
+
+NESSNESScanner::NESSNESScanner()
+{
+  nttActive = false;
+  padsPresent = true;
+  padsChanged = false;
+  _bit = 0;
+  _endBit = SNES_BITS;
+  _padLines = 0;
+  _timing = BUS_TIMING_SAFE;
+  setDelays(_timing);
+}
+
+void NESSNESScanner::scan(uint32_t data[2][2])
+{
+  begin();
+  while(step());
+  finish(data);
+}
+
+void NESSNESScanner::begin(bool probe)
+{
+  setDelays(probe ? BUS_TIMING_SAFE : _timing);
+  sendLatch();
+  _bit = 0;
+  _endBit = probe ? PRESENCE_BITS : SNES_BITS;
+}
+
+bool NESSNESScanner::step()
+{
+  if(complete())
+    return false;
+
+  sample();
+  sendClock();
+
+  return true;
+}
+
+bool NESSNESScanner::stepFor(uint8_t us)
+{
+  // Only the clock delays of a step are counted, the sampling on top only
+  // makes it longer
+  int16_t left = us * (int16_t)(F_CPU / 1000000);
+  uint8_t stepCycles = 3 * (_clockHigh + _clockLow);
+  bool more = true;
+
+  while(left > 0 && (more = step()))
+    left -= stepCycles;
+
+  // 4 cycles per loop
+  if(left > 0)
+    _delay_loop_2((left + 3) / 4);
+
+  return more;
+}
+
+bool NESSNESScanner::complete()
+{
+  if(_bit == NTT_BITS)
+    return true;
+
+  // If no NTT controller, end the scan early
+  return _bit == _endBit && (_samples[SNES_BITS - 1] & SNES_DATA);
+}
+
+void NESSNESScanner::sample()
+{
+  _samples[_bit++] = (PINF & (NES_DATA | SNES_DATA)) | (PINB & (POWERPAD_D4 | POWERPAD_D3));
+}
+
+void NESSNESScanner::finish(uint32_t data[2][2])
+{
+  // Bits that were not shifted out read as released
+  for(uint8_t bit = _bit; bit < NTT_BITS; bit++)
+    _samples[bit] = 0xFF;
+
+  uint8_t nes   = gatherPlane(&_samples[0], NES_DATA);
+  uint8_t d4    = gatherPlane(&_samples[0], POWERPAD_D4);
+  uint8_t d3    = gatherPlane(&_samples[0], POWERPAD_D3);
+  uint8_t snes0 = gatherPlane(&_samples[0], SNES_DATA);
+  uint8_t snes1 = gatherPlane(&_samples[8], SNES_DATA);
+  uint8_t snes2 = gatherPlane(&_samples[16], SNES_DATA);
+  uint8_t snes3 = gatherPlane(&_samples[24], SNES_DATA);
+
+  nttActive = snes1 & 0x20;
+
+  padsChanged = false;
+
+  if(_endBit == PRESENCE_BITS)
+  {
+    uint8_t lines = (~_samples[NES_BITS] & (NES_DATA | POWERPAD_D4 | POWERPAD_D3)) |
+                    (~_samples[PRESENCE_BITS - 1] & SNES_DATA);
+
+    // An NTT keypad sends key data past the SNES register
+    if(nttActive)
+      lines |= SNES_DATA;
+
+    padsPresent = (lines != 0);
+    padsChanged = (lines != _padLines);
+    _padLines = lines;
+  }
+
+  data[NES][BUTTONS] = pgm_read_byte(&nesButtons[nes & 0x0F])
+                     | pgm_read_word(&powerPadD4[d4 & 0x0F])
+                     | pgm_read_word(&powerPadD3Low[d3 & 0x0F])
+                     | pgm_read_word(&powerPadD3High[d3 >> 4]);
+  data[NES][AXES] = nes >> 4;
+
+  // NTT keys 0-9, *, #, ., C, (no data), End Comms land on bits 8-23. A
+  // probe also clocks past the end of a plain SNES pad, leave that out.
+  uint16_t ntt = nttActive ? ((uint16_t)snes3 << 8 | snes2) & 0xBFFF : 0;
+
+  data[SNES][BUTTONS] = pgm_read_byte(&snesButtonsLow[snes0 & 0x0F])
+                      | pgm_read_byte(&snesButtonsHigh[snes1 & 0x0F])
+                      | ((uint32_t)ntt << 8);
+  data[SNES][AXES] = snes0 >> 4;
+}
+
+uint8_t NESSNESScanner::calibrate()
+{
+  uint8_t reference[PRESENCE_BITS];
+
+  setDelays(BUS_TIMING_SAFE);
+  begin(true);
+  while(step());
+  memcpy(reference, _samples, PRESENCE_BITS);
+
+  // A button pressed meanwhile only ends the search early (slower)
+  uint8_t fastest = BUS_TIMING_SAFE;
+  while(fastest > 1 && readMatches(fastest - 1, reference))
+    fastest--;
+
+  _timing = min(fastest + fastest / 4 + 1, BUS_TIMING_SAFE);
+  setDelays(_timing);
+  return _timing;
+}
+
+bool NESSNESScanner::readMatches(uint8_t timing, const uint8_t *reference)
+{
+  setDelays(timing);
+
+  for(uint8_t read = 0; read < BUS_TIMING_READS; read++)
+  {
+    sendLatch();
+    _bit = 0;
+    _endBit = PRESENCE_BITS;
+    while(step());
+
+    if(memcmp(_samples, reference, PRESENCE_BITS) != 0)
+      return false;
+  }
+
+  return true;
+}
+
+void NESSNESScanner::setDelays(uint8_t timing)
+{
+  // BUS_TIMING_SAFE gives the original 192/72/96/72 cycles
+  _latchHigh = timing * 4;
+  _latchLow  = (timing * 3 + 1) / 2;
+  _clockHigh = timing * 2;
+  _clockLow  = (timing * 3 + 1) / 2;
+}
+
+void NESSNESScanner::sendLatch()
+{
+  // Send a latch pulse to NES/SNES, 3 cycles per delay loop
+  PORTD |=  B00000010; // Set HIGH
+  _delay_loop_1(_latchHigh);
+  PORTD &= ~B00000010; // Set LOW
+  _delay_loop_1(_latchLow);
+}
+
+void NESSNESScanner::sendClock()
+{
+  // Send a clock pulse to NES/SNES
+  PORTD |=  B00000001; // Set HIGH
+  _delay_loop_1(_clockHigh);
+  PORTD &= ~B00000001; // Set LOW
+  _delay_loop_1(_clockLow);
+}
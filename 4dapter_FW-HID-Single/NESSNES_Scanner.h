@@ -0,0 +1,117 @@
+/*  NESSNES_Scanner.h
+ *
+ *  Reads the shared NES/SNES bus (NES pad, Power Pad and SNES/NTT pad) in a
+ *  single pass. Every clock only snapshots the data lines into a sample
+ *  buffer, the button words are built from lookup tables afterwards.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef NESSNES_Scanner_h
+#define NESSNES_Scanner_h
+
+#include <Arduino.h>
+
+#define NES       0
+#define SNES      1
+
+#define BUTTONS   0
+#define AXES      1
+
+#define UP        0x01
+#define DOWN      0x02
+#define LEFT      0x04
+#define RIGHT     0x08
+
+// Data lines, PINF and PINB bits don't overlap so one sample byte holds all four
+#define NES_DATA      B10000000 // PF7
+#define SNES_DATA     B01000000 // PF6
+#define POWERPAD_D4   B00100000 // PB5
+#define POWERPAD_D3   B00010000 // PB4
+
+#define NES_BITS      8
+#define SNES_BITS     14 // SNES pad incl. the NTT indicator bit
+#define NTT_BITS      32
+#define PRESENCE_BITS 17 // One past the SNES register, plugged in pads shift in low (pressed) bits
+
+// Latch/clock timing steps, each adds 0.75us to the latch pulse and
+// 0.375us/0.28us to the clock high/low time
+#define BUS_TIMING_SAFE   16 // 12us latch, 6us/4.5us clock, slow enough for wireless receivers
+#define BUS_TIMING_READS  4  // Reads per step that have to match during calibrate()
+
+class NESSNESScanner
+{
+  public:
+    NESSNESScanner();
+
+    // Latches and shifts out all controllers on the bus and writes the
+    // result to data[NES|SNES][BUTTONS|AXES]
+    void scan(uint32_t data[2][2]);
+
+    // The same scan split up, so other work can be done between the clocks.
+    // step() samples and clocks one bit (~10.5us at BUS_TIMING_SAFE), false
+    // once all bits are in.
+    void begin(bool probe = false);
+    bool step();
+    void finish(uint32_t data[2][2]);
+
+    // Steps for at least 'us', clocking as many bits as fit and waiting out
+    // the rest, so a settle time elsewhere can be spent on the bus without
+    // being cut short by a fast calibrated timing. False once all bits are in.
+    bool stepFor(uint8_t us);
+
+    void sendLatch();
+    void sendClock();
+
+    bool nttActive;
+
+    // Set by a scan begun with 'probe': a pad answered on the bus. The probe
+    // clocks up to PRESENCE_BITS, past the end of the NES, Power Pad and
+    // SNES shift registers, where only a plugged in pad pulls the lines low.
+    bool padsPresent;
+
+    // Set by a probe: pads were plugged into or out of one of the lines
+    // since the last probe, calibrate() again. Probes always run with
+    // BUS_TIMING_SAFE so a slow pad shows up.
+    bool padsChanged;
+
+    // Finds the fastest timing the pads on the bus still shift out the same
+    // bits with as with BUS_TIMING_SAFE, including the end of their
+    // registers, and uses it plus a quarter as margin. Takes a few ms.
+    uint8_t calibrate();
+    uint8_t timing() const { return _timing; }
+
+  private:
+    bool complete();
+    void sample();
+    void setDelays(uint8_t timing);
+    bool readMatches(uint8_t timing, const uint8_t *reference);
+
+    uint8_t _samples[NTT_BITS];
+    uint8_t _bit;
+    uint8_t _endBit;
+    uint8_t _padLines;      // Lines a pad answered on at the last probe
+
+    uint8_t _timing;
+    uint8_t _latchHigh;     // _delay_loop_1() counts of the current scan
+    uint8_t _latchLow;
+    uint8_t _clockHigh;
+    uint8_t _clockLow;
+};
+
+#endif
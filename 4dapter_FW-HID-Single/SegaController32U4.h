@@ -109,6 +109,11 @@ class SegaController32U4
     word updateState(void);
     word getFinalState(void);
 
+    // updateState() in two halves, so the SC_CYCLE_DELAY settle time can be
+    // spent elsewhere. readState() must not follow before that time is up.
+    void toggleSelect(void);
+    word readState(void);
+
   private:
     // Should A and B and X and Y be swapped?
     void toggleMisterMode(void);
@@ -21,13 +21,22 @@
 #include "SegaController32U4.h"
 #include "Gamepad.h"
 #include "N64_Controller.h"
+#include "N64Stick.h"
+#include "NESSNES_Scanner.h"
+#include "FrameScheduler.h"
+#include "PortPresence.h"
+#include "PressLatch.h"
+#include "BusSampler.h"
+#include "LatencyStats.h"
+#include "PhaseProfiler.h"
+#include "PakTransfer.h"
 
 // ATT: 20 chars max (including NULL at the end) according to Arduino source code.
 // Additionally serial number is used to differentiate arduino projects to have different button maps!
 const char *gp_serial = "4DAPTER";
 
 #define N64MapJoyToMax  true  // 'true' to map value to DInput Max (-128 to +127), set to false to use controller value directly
-#define N64JoyMax       80     // N64 Joystick Maximum Travel Range (0-127, typically between 75-85 on OEM controllers)
+#define N64JoyMax       80     // N64 Joystick Maximum Travel Range until learned (0-127, typically between 75-85 on OEM controllers)
 #define N64JoyDeadzone  3      // Deadzone to return 0, minimizes drift
 
 N64Controller       n64_controller;
@@ -35,29 +44,11 @@ N64_status_packet   N64Data;
 int8_t LeftX = 0;
 int8_t LeftY = 0;
 
-// Rumble support variables
-bool lastRumbleState = false;
-unsigned long rumbleCheckTimer = 0;
-const unsigned long RUMBLE_CHECK_INTERVAL = 100; // Check every 100ms
-
-#define NES       0
-#define SNES      1
 #define GENESIS   2
 
-#define BUTTONS   0
-#define AXES      1
-
-#define UP        0x01
-#define DOWN      0x02
-#define LEFT      0x04
-#define RIGHT     0x08
-
-#define NTT_BIT   0x00
-#define NODATA    0x00
-
-void sendLatch();
-void sendClock();
 void sendState();
+int8_t gcAxis(uint8_t value, bool invert);
+uint32_t n64Buttons();
 
 // Controller DB9 pins (looking face-on to the end of the plug):
 // 5 4 3 2 1
@@ -128,84 +119,47 @@ void sendState();
 
 // Manage EEPROM by making sure everything has
 // its own index.
-enum EEPROMIndices { GENESIS_EEPROM };
+// N64_STICK_EEPROM takes N64_STICK_EEPROM_SIZE bytes.
+enum EEPROMIndices { GENESIS_EEPROM, N64_STICK_EEPROM };
 
-// Set up USB HID gamepads
-Gamepad_ Gamepad[3];
+// Set up USB HID gamepads. Each element is constructed in place, the
+// constructor plugs 'this' into the USB core.
+Gamepad_ Gamepad[3] = { {}, {}, {GAMEPAD_RUMBLE | GAMEPAD_ANALOG} };
+
+#if (PAK_TRANSFER == true)
+// Controller Pak backup/restore interface, after the gamepads so their interface numbers stay
+PakTransfer_ PakTransfer(n64_controller);
+#endif
 
 SegaController32U4 controller(GENESIS_EEPROM);
 
+// N64 stick conversion and travel calibration, see N64Stick.h
+N64Stick n64Stick(N64_STICK_EEPROM, N64_STICK_SIGNED, true, N64JoyMax, N64JoyDeadzone, N64MapJoyToMax);
+
+// Starts each scan so it finishes right before the next USB frame
+FrameScheduler scheduler;
+
 // Controllers
+NESSNESScanner scanner;
 uint32_t  controllerData[2][2] = {{0,0},{0,0}};
-uint32_t  axisIndicator[32] = {0,0,0,0,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
 uint16_t  currentState = 0;
-bool      nttActive = false;
-
-uint32_t  dataMaskNES[8] =        {0x02,   // A
-                                   0x01,   // B
-                                   0x40,   // Start 
-                                   0x80,   // Select
-                                   UP,     // D-Up
-                                   DOWN,   // D-Down
-                                   LEFT,   // D-Left
-                                   RIGHT   // D-Right
-                                   }; 
-
-// Power Pad D4
-uint32_t  dataMaskPowerPadD4[8] = {0x08,    // PowerPad #4
-                                   0x04,    // PowerPad #3
-                                   0x800,   // PowerPad #12
-                                   0x80,    // PowerPad #8
-                                   NODATA,  // No Data
-                                   NODATA,  // No Data
-                                   NODATA,  // No Data
-                                   NODATA   // No Data
-                                   }; 
-
-// Power Pad D3
-uint32_t  dataMaskPowerPadD3[8] = {0x02,   // PowerPad #2
-                                   0x01,   // PowerPad #1
-                                   0x10,   // PowerPad #5
-                                   0x100,  // PowerPad #9
-                                   0x20,   // PowerPad #6
-                                   0x200,  // PowerPad #10
-                                   0x400,  // PowerPad #11
-                                   0x40    // PowerPad #7
-                                   }; 
-
-uint32_t  dataMaskSNES[32] =      {0x01,    // B
-                                   0x04,    // Y
-                                   0x40,    // Start   
-                                   0x80,    // Select
-                                   UP,      // D-Up
-                                   DOWN,    // D-Down
-                                   LEFT,    // D-Left
-                                   RIGHT,   // D-Right
-                                   0x02,    // A
-                                   0x08,    // X
-                                   0x10,    // L
-                                   0x20,    // R
-                                   NODATA,  // SNES Control Bit
-                                   NTT_BIT, // NTT Indicator Bit
-                                   NODATA,  // SNES Control Bit
-                                   NODATA,  // SNES Control Bit
-                                   0x100,   // NTT 0
-                                   0x200,   // NTT 1
-                                   0x400,   // NTT 2
-                                   0x800,   // NTT 3
-                                   0x1000,  // NTT 4
-                                   0x2000,  // NTT 5
-                                   0x4000,  // NTT 6
-                                   0x8000,  // NTT 7
-                                   0x10000, // NTT 8
-                                   0x20000, // NTT 9
-                                   0x40000, // NTT *
-                                   0x80000, // NTT #
-                                   0x100000,// NTT .
-                                   0x200000,// NTT C
-                                   NODATA,  // NTT No Data
-                                   0x800000,// NTT End Comms
-                                   };
+unsigned long genesisScanTime = 0;
+
+// Empty ports are only probed every PRESENCE_PROBE_MS
+PortPresence genesisPort;
+PortPresence busPort;     // NES/SNES/Power Pad, one shared latch and clock
+PortPresence n64Port;
+
+#if (PRESS_LATCH == true)
+// Presses held until the host collected a report with them, see PressLatch.h
+PressLatch busLatch[2];   // [BUTTONS|AXES], NES and SNES merged like Gamepad[0]
+PressLatch genesisLatch;
+PressLatch n64Latch;      // n64Buttons()
+#define LATCH(latch, pressed)  (latch).sample(pressed)
+void sampleInputs();
+#else
+#define LATCH(latch, pressed)  (pressed)
+#endif
 
 void setup()
 {
@@ -235,145 +189,184 @@ void setup()
   
   // Initialize rumble pak detection (simple, no startup test for now)
   n64_controller.checkRumblePak();
+
+#if (LATENCY_STATS == true)
+  latencyStats.begin();
+#endif
+#if (PROFILE_PHASES == true)
+  phaseProfiler.begin();
+#endif
+#if (PRESS_LATCH == true)
+  scheduler.setIdleTask(sampleInputs, LATCH_SAMPLE_US);
+#endif
+#if (BUS_SAMPLER == true)
+  busSampler.begin();
+#endif
 }
 
 void loop() 
 { 
   while(true)
   {
-    //8 cycles needed to capture 6-button controllers
-    for(uint8_t i = 0; i < 8; i++)
+    PROFILE_PHASE(PROF_WAIT);
+    scheduler.waitForScanSlot();
+    unsigned long now = millis();
+
+#if (PRESS_LATCH == true)
+    // Reports the host collected since the last pass take their presses along
+    if(Gamepad[0].delivered())
+    {
+      busLatch[BUTTONS].delivered();
+      busLatch[AXES].delivered();
+    }
+    if(Gamepad[1].delivered())
+      genesisLatch.delivered();
+    if(Gamepad[2].delivered())
+      n64Latch.delivered();
+#endif
+
+    // 6-button controllers only restart their cycle after SC_RESET_DELAY without
+    // select activity, so at 1kHz they are read every other frame. 3-button
+    // and SMS/Atari pads have no such cycle and are read every frame.
+    // An empty port is left alone until it is probed again or a line goes low
+    // (SMS/Atari pads can't be told from an empty port until pressed).
+    bool genesisDue = (!controller.sixButton() || micros() - genesisScanTime >= SC_RESET_DELAY) &&
+                      (genesisPort.due(now) || controller.inputActive());
+
+#if (BUS_SAMPLER == true)
+    // Scanned by the Timer3 interrupt
+    bool busDue = false;
+    bool busProbe = false;
+#else
+    // The probe runs past the shift registers, every PRESENCE_PROBE_MS also
+    // with pads present to notice them being unplugged
+    bool busDue = busPort.due(now);
+    bool busProbe = busPort.probeDue(now);
+#endif
+
+    PROFILE_PHASE(PROF_GENESIS);
+    if(busDue)
+      scanner.begin(busProbe);
+
+    if(genesisDue)
+    {
+      //8 cycles needed to capture 6-button controllers, the select line settle
+      //time of each one is spent clocking the NES/SNES bus. A calibrated step
+      //is much shorter than SC_CYCLE_DELAY, stepFor() fits several in.
+      for(uint8_t i = 0; i < 8; i++)
+      {
+        controller.toggleSelect();
+
+        if(busDue)
+          scanner.stepFor(SC_CYCLE_DELAY);
+        else
+          delayMicroseconds(SC_CYCLE_DELAY);
+
+        currentState = controller.readState();
+      }
+      genesisScanTime = micros();
+    }
+
+    PROFILE_PHASE(PROF_NESSNES);
+    if(busDue)
+    {
+      while(scanner.step());
+      scanner.finish(controllerData);
+
+      if(busProbe)
+      {
+        busPort.update(scanner.padsPresent, now);
+
+        // Pads plugged in or out, find the latch/clock timing they all keep up with
+        if(scanner.padsChanged)
+          scanner.calibrate();
+      }
+    }
+#if (BUS_SAMPLER == true)
+    busSampler.read(controllerData);
+#endif
+
+#if (LATENCY_STATS == true)
+    latencyStats.input(LAT_NES, controllerData[NES][BUTTONS] | (controllerData[NES][AXES] << 24));
+    latencyStats.input(LAT_SNES, controllerData[SNES][BUTTONS] | (controllerData[SNES][AXES] << 24));
+#endif
+
+    if(genesisDue)
     {
-      currentState = controller.updateState();
+      currentState = controller.getFinalState();
+      genesisPort.update(controller.connected() || currentState != 0, now);
+#if (LATENCY_STATS == true)
+      latencyStats.input(LAT_GENESIS, currentState);
+#endif
     }
 
-    currentState = controller.getFinalState();
-    Gamepad[1]._GamepadReport.buttons = currentState >> 4;
+    // Rebuilt every pass, a delivered latch changes it without a new read
+    uint16_t genesisState = LATCH(genesisLatch, currentState);
+    Gamepad[1]._GamepadReport.buttons = genesisState >> 4;
 
-    if      (((currentState & SC_BTN_DOWN) >> SC_BIT_SH_DOWN))    Gamepad[1]._GamepadReport.Y = 0x7F;
-    else if (((currentState & SC_BTN_UP) >> SC_BIT_SH_UP))        Gamepad[1]._GamepadReport.Y = 0x80;
+    if      (((genesisState & SC_BTN_DOWN) >> SC_BIT_SH_DOWN))    Gamepad[1]._GamepadReport.Y = 0x7F;
+    else if (((genesisState & SC_BTN_UP) >> SC_BIT_SH_UP))        Gamepad[1]._GamepadReport.Y = 0x80;
     else                                                          Gamepad[1]._GamepadReport.Y = 0;
 
-    if      (((currentState & SC_BTN_RIGHT) >> SC_BIT_SH_RIGHT))  Gamepad[1]._GamepadReport.X = 0x7F;
-    else if (((currentState & SC_BTN_LEFT) >> SC_BIT_SH_LEFT))    Gamepad[1]._GamepadReport.X = 0x80;
+    if      (((genesisState & SC_BTN_RIGHT) >> SC_BIT_SH_RIGHT))  Gamepad[1]._GamepadReport.X = 0x7F;
+    else if (((genesisState & SC_BTN_LEFT) >> SC_BIT_SH_LEFT))    Gamepad[1]._GamepadReport.X = 0x80;
     else                                                          Gamepad[1]._GamepadReport.X = 0;
 
     for(uint8_t j = 0; j < 1; j++)
     {
-      sendLatch();
+      uint32_t busButtons = LATCH(busLatch[BUTTONS], controllerData[NES][BUTTONS] | controllerData[SNES][BUTTONS]);
+      uint8_t  busAxes    = LATCH(busLatch[AXES], controllerData[NES][AXES] | controllerData[SNES][AXES]);
 
-      controllerData[NES][BUTTONS] = 0;
-      controllerData[NES][AXES] = 0;
+      Gamepad[0]._GamepadReport.buttons = busButtons;
       
-      controllerData[SNES][BUTTONS] = 0;
-      controllerData[SNES][AXES] = 0;
-
-      nttActive = false;
-  
-      for(uint8_t dataBitCounter = 0; dataBitCounter < 32; dataBitCounter++)
-      {
-        // If no NTT controller, end the loop early
-        if(!nttActive && dataBitCounter > 13)
-        {
-          break;
-        }
-
-        //NES Power Pad Controller
-        if((dataBitCounter < 8) && ((PINB & B00100000) == 0)) //Power Pad Pin D4 (bottom)
-        { 
-          controllerData[NES][BUTTONS] |= dataMaskPowerPadD4[dataBitCounter];
-        }
-
-        if((dataBitCounter < 8) && ((PINB & B00010000) == 0)) //Power Pad Pin D3 (middle)
-        { 
-          controllerData[NES][BUTTONS] |= dataMaskPowerPadD3[dataBitCounter];
-        }
-
-        // NES Controller
-        if((dataBitCounter < 8) && ((PINF & B10000000) == 0)) //If NES data line is low (indicating a press)
-        { 
-          if(axisIndicator[dataBitCounter])
-          {
-            controllerData[NES][AXES] |= dataMaskNES[dataBitCounter];
-          }
-          else
-          {
-            controllerData[NES][BUTTONS] |= dataMaskNES[dataBitCounter];
-          }
-        }
-
-        // SNES / NTT Controller 
-        if((PINF & B01000000) == 0) //If SNES data line is low (indicating a press)
-        {
-          if(dataBitCounter == 13)
-          {
-            nttActive = true;
-          }
-          
-          if(axisIndicator[dataBitCounter])
-          {
-            controllerData[SNES][AXES] |= dataMaskSNES[dataBitCounter];
-          }
-          else
-          {
-            controllerData[SNES][BUTTONS] |= dataMaskSNES[dataBitCounter];
-          }
-        }
-        
-        sendClock();
-      }
-  
-      Gamepad[0]._GamepadReport.buttons = controllerData[NES][BUTTONS] | controllerData[SNES][BUTTONS];
-      
-      if      ( ((controllerData[NES][AXES] & DOWN) >> 1) | ((controllerData[SNES][AXES] & DOWN) >> 1))  Gamepad[0]._GamepadReport.Y = 0x7F;
-      else if (  (controllerData[NES][AXES] & UP  )       |  (controllerData[SNES][AXES] & UP  )      )  Gamepad[0]._GamepadReport.Y = 0x80;
+      if      (busAxes & DOWN)   Gamepad[0]._GamepadReport.Y = 0x7F;
+      else if (busAxes & UP)     Gamepad[0]._GamepadReport.Y = 0x80;
       else    Gamepad[0]._GamepadReport.Y = 0;
 
-      if      ( ((controllerData[NES][AXES] & RIGHT) >> 3) | ((controllerData[SNES][AXES] & RIGHT) >> 3))  Gamepad[0]._GamepadReport.X = 0x7F;
-      else if ( ((controllerData[NES][AXES] & LEFT ) >> 2) | ((controllerData[SNES][AXES] & LEFT ) >> 2))  Gamepad[0]._GamepadReport.X = 0x80;
+      if      (busAxes & RIGHT)  Gamepad[0]._GamepadReport.X = 0x7F;
+      else if (busAxes & LEFT)   Gamepad[0]._GamepadReport.X = 0x80;
       else    Gamepad[0]._GamepadReport.X = 0;
       
-      n64_controller.getN64Packet();
+      PROFILE_PHASE(PROF_N64);
+      if(n64Port.due(now))
+      {
+        n64_controller.getN64Packet();
+        n64Port.update(n64_controller.controllerType != JOYBUS_NONE, now);
+      }
       N64Data = n64_controller.N64_status;
+#if (LATENCY_STATS == true)
+      latencyStats.input(LAT_N64, ((uint32_t)(uint8_t)N64Data.stick_x << 24) | ((uint32_t)(uint8_t)N64Data.stick_y << 16) | (N64Data.data2 << 8) | N64Data.data1);
+#endif
+      uint32_t n64State = LATCH(n64Latch, n64Buttons());
+      N64Data.data1 = n64State;
+      N64Data.data2 = n64State >> 8;
 
       Gamepad[2]._GamepadReport.X = 0;
       Gamepad[2]._GamepadReport.Y = 0;
       Gamepad[2]._GamepadReport.buttons = 0;
+      Gamepad[2]._GamepadReport.Rx = 0;
+      Gamepad[2]._GamepadReport.Ry = 0;
+      Gamepad[2]._GamepadReport.Z = 0;
+      Gamepad[2]._GamepadReport.Rz = 0;
       
-      if(N64Data.stick_x >= -N64JoyDeadzone && N64Data.stick_x <= N64JoyDeadzone)
-      {
-        LeftX = 0;
-      }
-      else
-      {
-        if(N64MapJoyToMax)
-        {
-          if(N64Data.stick_x > N64JoyMax)   N64Data.stick_x = N64JoyMax;
-          if(N64Data.stick_x < -N64JoyMax)  N64Data.stick_x = -N64JoyMax;
-          LeftX = map(N64Data.stick_x, -N64JoyMax, N64JoyMax, -128, 127);
-        }
-        else
-        {
-          LeftX = (int8_t)N64Data.stick_x;
-        }
-      }
-
-      if(N64Data.stick_y >= -N64JoyDeadzone && N64Data.stick_y <= N64JoyDeadzone)
+      if (n64_controller.controllerType == JOYBUS_GAMECUBE)
       {
-        LeftY = 0;
+        // Full range GameCube sticks, the N64 stick tables don't apply
+        GC_status_packet &gc = n64_controller.GC_status;
+        LeftX = gcAxis(gc.stick_x, false);
+        LeftY = gcAxis(gc.stick_y, true);
+        Gamepad[2]._GamepadReport.Rx = gcAxis(gc.cstick_x, false);
+        Gamepad[2]._GamepadReport.Ry = gcAxis(gc.cstick_y, true);
+        Gamepad[2]._GamepadReport.Z  = gc.trigger_l;
+        Gamepad[2]._GamepadReport.Rz = gc.trigger_r;
+        Gamepad[2]._GamepadReport.buttons |= ((n64State >> 16) & GC_BTN_X ? 1:0) << 14; // X
+        Gamepad[2]._GamepadReport.buttons |= ((n64State >> 16) & GC_BTN_Y ? 1:0) << 15; // Y
       }
       else
       {
-        if(N64MapJoyToMax)
-        {
-          if(N64Data.stick_y > N64JoyMax)   N64Data.stick_y = N64JoyMax;
-          if(N64Data.stick_y < -N64JoyMax)  N64Data.stick_y = -N64JoyMax;
-          LeftY = map(-N64Data.stick_y, -N64JoyMax, N64JoyMax, -128, 127); 
-        }
-        else
-        {
-          LeftY = (int8_t) -N64Data.stick_y;
-        }
+        n64Stick.update(N64Data);
+        LeftX = (int8_t)n64Stick.x(N64Data.stick_x);
+        LeftY = (int8_t)n64Stick.y(N64Data.stick_y);
       }
 
 
@@ -398,46 +391,104 @@ void loop()
       
       Gamepad[2]._GamepadReport.X = LeftX;
       Gamepad[2]._GamepadReport.Y = LeftY;
-      
-      // Simple rumble test: vibrate when Start button is pressed
-      static bool startPressed = false;
-      bool currentStart = (N64Data.data1 & 0x10) != 0; // Start button
-      
-      if (currentStart && !startPressed) {
-        // Start button just pressed - trigger short rumble
-        n64_controller.setRumble(true);
-        delay(100); // Very short rumble
-        n64_controller.setRumble(false);
-      }
-      startPressed = currentStart;
     }    
 
-  sendState();
- }
+    sendState();
+    scheduler.scanDone();
+
+    // The reports are handed over, one Joybus transfer of over a millisecond
+    // (a Rumble Pak write, a pak block) only delays the next scan. Rumble as
+    // requested by the host over the N64 output report goes first.
+    bool rumbleOn;
+    if (n64Port.present() && Gamepad[2].rumbleRequest(&rumbleOn))
+      n64_controller.setRumble(rumbleOn);
+#if (PAK_TRANSFER == true)
+    else
+      PakTransfer.service();
+#endif
+  }
 }
 
-void sendLatch()
+// GameCube stick byte (128 = center) to a HID axis, 'invert' for up = negative
+int8_t gcAxis(uint8_t value, bool invert)
 {
-  // Send a latch pulse to NES/SNES
-  PORTD |=  B00000010; // Set HIGH
-  __builtin_avr_delay_cycles(192);
-  PORTD &= ~B00000010; // Set LOW
-  __builtin_avr_delay_cycles(72);
+  int16_t axis = invert ? 128 - (int16_t)value : (int16_t)value - 128;
+  return constrain(axis, -127, 127);
 }
 
-void sendClock()
+// N64 buttons as data1 | data2 << 8, a GameCube pad's X and Y from bit 16 on
+uint32_t n64Buttons()
 {
-  // Send a clock pulse to NES/SNES
-  PORTD |=  B00000001; // Set HIGH
-  __builtin_avr_delay_cycles(96);
-  PORTD &= ~B00000001; // Set LOW
-  __builtin_avr_delay_cycles(72);
+  uint32_t buttons = n64_controller.N64_status.data1 | (n64_controller.N64_status.data2 << 8);
+
+  if (n64_controller.controllerType == JOYBUS_GAMECUBE)
+    buttons |= (uint32_t)(n64_controller.GC_status.buttons1 & (GC_BTN_X | GC_BTN_Y)) << 16;
+
+  return buttons;
+}
+
+#if (PRESS_LATCH == true)
+// Extra scans while the scheduler waits for the scan slot, their presses
+// reach the next reports through the latches. Not the Genesis port, 6-button
+// pads need SC_RESET_DELAY between reads, and not the N64 port, a poll masks
+// interrupts for its whole reply (up to the timeout on an empty port).
+// The N64 port stays at one poll per loop pass.
+void sampleInputs()
+{
+  uint32_t data[2][2];
+  bool busRead;
+
+#if (BUS_SAMPLER == true)
+  busRead = busSampler.read(data);
+#else
+  busRead = busPort.present();
+  if(busRead)
+    scanner.scan(data);
+#endif
+
+  if(busRead)
+  {
+    busLatch[BUTTONS].sample(data[NES][BUTTONS] | data[SNES][BUTTONS]);
+    busLatch[AXES].sample(data[NES][AXES] | data[SNES][AXES]);
+  }
 }
+#endif
 
 void sendState()
 {
-  Gamepad[0].send();
-  Gamepad[1].send();
-  Gamepad[2].send();
-  __builtin_avr_delay_cycles(16000);
+  PROFILE_PHASE(PROF_SEND_NES);
+  bool sent = Gamepad[0].send();
+#if (LATENCY_STATS == true)
+  latencyStats.reported(LAT_NES, Gamepad[0].endpoint(), sent);
+  latencyStats.reported(LAT_SNES, Gamepad[0].endpoint(), sent);
+#endif
+#if (PRESS_LATCH == true)
+  if(sent)
+  {
+    busLatch[BUTTONS].sent();
+    busLatch[AXES].sent();
+  }
+#endif
+
+  PROFILE_PHASE(PROF_SEND_GENESIS);
+  sent = Gamepad[1].send();
+#if (LATENCY_STATS == true)
+  latencyStats.reported(LAT_GENESIS, Gamepad[1].endpoint(), sent);
+#endif
+#if (PRESS_LATCH == true)
+  if(sent)
+    genesisLatch.sent();
+#endif
+
+  PROFILE_PHASE(PROF_SEND_N64);
+  sent = Gamepad[2].send();
+#if (LATENCY_STATS == true)
+  latencyStats.reported(LAT_N64, Gamepad[2].endpoint(), sent);
+#endif
+#if (PRESS_LATCH == true)
+  if(sent)
+    n64Latch.sent();
+#endif
+
+  (void)sent; // Only read by the options above
 }
@@ -0,0 +1,109 @@
+/*  BusSampler.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BusSampler.h"
+
+#if (BUS_SAMPLER == true)
+
+// Timer3 runs at F_CPU / 8
+#define BUS_TICKS(us)   ((us) * (F_CPU / 8000000UL))
+#define BUS_LATE_TICKS  BUS_TICKS(4) // Closest a compare is set ahead of the counter
+
+BusSampler busSampler;
+
+ISR(TIMER3_COMPA_vect)
+{
+  busSampler.edge();
+}
+
+BusSampler::BusSampler(void)
+{
+  _scanning = false;
+  _scanStart = 0;
+  _newest = 0;
+  _published = 0;
+  _read = 0;
+
+  for(uint8_t b = 0; b < 2; b++)
+    for(uint8_t p = 0; p < 2; p++)
+      _data[b][p][BUTTONS] = _data[b][p][AXES] = 0;
+}
+
+void BusSampler::begin(void)
+{
+  TCCR3A = 0;          // Normal mode, OC3A/OC3B/OC3C disconnected
+  TCCR3B = _BV(CS31);  // clk/8
+  TCCR3C = 0;
+
+  OCR3A  = TCNT3 + BUS_TICKS(BUS_EDGE_US);
+  TIFR3  = _BV(OCF3A);
+  TIMSK3 |= _BV(OCIE3A);
+}
+
+bool BusSampler::read(uint32_t data[2][2])
+{
+  uint8_t published = _published;
+  uint8_t newest = _newest;
+
+  data[NES][BUTTONS]  = _data[newest][NES][BUTTONS];
+  data[NES][AXES]     = _data[newest][NES][AXES];
+  data[SNES][BUTTONS] = _data[newest][SNES][BUTTONS];
+  data[SNES][AXES]    = _data[newest][SNES][AXES];
+
+  bool fresh = (published != _read);
+  _read = published;
+  return fresh;
+}
+
+void BusSampler::edge(void)
+{
+  uint16_t next;
+
+  if(!_scanning)
+  {
+    _scanStart = OCR3A;
+    _scanner.beginEdges();
+    _scanning = true;
+    next = _scanStart + BUS_TICKS(BUS_EDGE_US);
+  }
+  else if(_scanner.edge())
+  {
+    next = OCR3A + BUS_TICKS(BUS_EDGE_US);
+  }
+  else
+  {
+    uint8_t buffer = _newest ^ 1;
+    _scanner.finish(_data[buffer]);
+    _newest = buffer;
+    _published++;
+
+    _scanning = false;
+    next = _scanStart + BUS_TICKS(BUS_SAMPLE_US);
+  }
+
+  // Interrupts were off for longer than an edge (N64 transfers): continue
+  // right away instead of after a full timer wrap
+  if((int16_t)(next - TCNT3) < (int16_t)BUS_LATE_TICKS)
+    next = TCNT3 + BUS_LATE_TICKS;
+
+  OCR3A = next;
+}
+
+#endif
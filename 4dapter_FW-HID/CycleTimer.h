@@ -0,0 +1,53 @@
+/*  CycleTimer.h
+ *
+ *  Timer1 as a free running CPU cycle counter (clk/1, 62.5ns per tick at 16MHz).
+ *  Everything that needs cycle exact timestamps shares it, so it is only ever
+ *  read: nobody may reconfigure Timer1 or write TCNT1 once it is running.
+ *  Pin 9 and 10 (OC1A/OC1B) stay disconnected, analogWrite() on them is not
+ *  available anymore.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define CYCLES_PER_US (F_CPU / 1000000UL)
+
+// Safe to call more than once, the counter is not reset
+static inline void cycleTimerInit(void)
+{
+  if(TCCR1A == 0 && TCCR1B == _BV(CS10))
+    return;
+
+  TCCR1A = 0;          // Normal mode, OC1A/OC1B/OC1C disconnected
+  TCCR1B = _BV(CS10);  // No prescaler
+  TCCR1C = 0;
+}
+
+static inline uint16_t cycleTimerNow(void)
+{
+  return TCNT1;
+}
+
+// Elapsed cycles since 'start', valid for spans up to 4ms
+static inline uint16_t cycleTimerSince(uint16_t start)
+{
+  return (uint16_t)(TCNT1 - start);
+}
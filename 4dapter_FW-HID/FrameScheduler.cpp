@@ -0,0 +1,117 @@
+/*  FrameScheduler.cpp
+ *
+ *  The Arduino core owns the USB general interrupt (and with it the SOF
+ *  interrupt), so Start-of-Frame is tracked through the frame number register
+ *  that the USB controller updates on every SOF packet.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameScheduler.h"
+#include "LatencyStats.h"
+#include "PhaseProfiler.h"
+
+FrameScheduler::FrameScheduler(void)
+{
+  _sofTime = 0;
+  _scanStart = 0;
+  _scanTime = FRAME_PERIOD_US / 2; // Pessimistic until the first scan was measured
+  _idleTask = NULL;
+  _idleInterval = 0;
+  _idleStart = 0;
+  _idleTime = FRAME_PERIOD_US / 4;
+}
+
+void FrameScheduler::setIdleTask(void (*task)(void), uint16_t interval)
+{
+  _idleTask = task;
+  _idleInterval = interval;
+}
+
+void FrameScheduler::waitForScanSlot(void)
+{
+  // Wait for the next SOF. The previous scan ended just before it, so this is short.
+  uint8_t frame = UDFNUML;
+  unsigned long start = micros();
+
+  while(UDFNUML == frame)
+  {
+#if (LATENCY_STATS == true)
+    latencyStats.poll();
+#endif
+#if (PROFILE_PHASES == true)
+    phaseProfiler.flush();
+#endif
+    if(micros() - start > FRAME_TIMEOUT_US)
+      break;
+  }
+
+  _sofTime = micros();
+
+  // Idle until the scan, finishing FRAME_GUARD_US before the next SOF, has to start
+  uint16_t lead = _scanTime + FRAME_GUARD_US;
+
+  if(lead < FRAME_PERIOD_US)
+  {
+    unsigned long slot = FRAME_PERIOD_US - lead;
+    unsigned long elapsed;
+
+    while((elapsed = micros() - _sofTime) < slot)
+    {
+      if(_idleTask && micros() - _idleStart >= _idleInterval && slot - elapsed > _idleTime)
+        runIdleTask();
+#if (LATENCY_STATS == true)
+      latencyStats.poll();
+#endif
+#if (PROFILE_PHASES == true)
+      phaseProfiler.flush();
+#endif
+    }
+  }
+
+  _scanStart = micros();
+}
+
+void FrameScheduler::runIdleTask(void)
+{
+  _idleStart = micros();
+  _idleTask();
+  unsigned long measured = micros() - _idleStart;
+
+  if(measured > FRAME_PERIOD_US)
+    measured = FRAME_PERIOD_US;
+
+  if(measured > _idleTime)
+    _idleTime = measured;
+  else
+    _idleTime -= (_idleTime - measured) >> 3;
+}
+
+void FrameScheduler::scanDone(void)
+{
+  unsigned long measured = micros() - _scanStart;
+
+  if(measured > FRAME_PERIOD_US)
+    measured = FRAME_PERIOD_US;
+
+  // Follow longer scans immediately, shorter ones slowly (N64 rumble writes etc.)
+  if(measured > _scanTime)
+    _scanTime = measured;
+  else
+    _scanTime -= (_scanTime - measured) >> 3;
+}
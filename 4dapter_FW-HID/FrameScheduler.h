@@ -0,0 +1,61 @@
+/*  FrameScheduler.h
+ *
+ *  Lines the controller scan up with the USB frame, so that the reports are
+ *  written to the endpoint banks just before the host's next IN token instead
+ *  of at some random point in the frame.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define FRAME_PERIOD_US   1000  // Full speed USB frame
+#define FRAME_GUARD_US    60    // Slack left between the end of the scan and the next SOF
+#define FRAME_TIMEOUT_US  1100  // No SOF for this long (suspended/unconfigured), run free
+
+class FrameScheduler
+{
+  public:
+    FrameScheduler(void);
+
+    // Blocks until the latest point in the current frame where a scan + send
+    // still completes before the next Start-of-Frame.
+    void waitForScanSlot(void);
+
+    // Call right after the reports were handed to the endpoints. Feeds the
+    // scan duration estimate used to place the next slot.
+    void scanDone(void);
+
+    // Runs 'task' while waiting for the scan slot, at most every 'interval'
+    // us and only if it still ends before the slot
+    void setIdleTask(void (*task)(void), uint16_t interval);
+
+  private:
+    void runIdleTask(void);
+
+    unsigned long _sofTime;
+    unsigned long _scanStart;
+    uint16_t      _scanTime;
+
+    void        (*_idleTask)(void);
+    uint16_t      _idleInterval;
+    unsigned long _idleStart;
+    uint16_t      _idleTime;      // Duration estimate of the task, like _scanTime
+};
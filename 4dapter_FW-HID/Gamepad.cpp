@@ -25,6 +25,12 @@
  */
 #include "Gamepad.h"
 
+// The core sets up all 64 byte endpoints double banked (EP_DOUBLE_64), which
+// writeEndpoint() relies on
+#if USB_EP_SIZE != 64
+#error "Gamepad_ needs double banked 64 byte endpoints"
+#endif
+
 static const uint8_t _hidReportDescriptor[] PROGMEM = {
   0x05, 0x01,                       // USAGE_PAGE (Generic Desktop)
   0x09, 0x04,                       // USAGE (Joystick) (Maybe change to gamepad? I don't think so but...)
@@ -54,10 +60,66 @@ static const uint8_t _hidReportDescriptor[] PROGMEM = {
       0xc0,                             // END_COLLECTION
 
     0xc0,                             // END_COLLECTION
+
+#if (LATENCY_STATS == true)
+    0x06, 0x00, 0xFF,                 // USAGE_PAGE (Vendor Defined 0xFF00)
+    0x09, 0x01,                       // USAGE (Latency statistics)
+    0x15, 0x00,                       // LOGICAL_MINIMUM (0)
+    0x26, 0xFF, 0x00,                 // LOGICAL_MAXIMUM (255)
+    0x95, LATENCY_REPORT_SIZE,        // REPORT_COUNT (40)
+    0x75, 0x08,                       // REPORT_SIZE (8)
+    0xb1, 0x02,                       // FEATURE (Data,Var,Abs)
+#endif
+};
+
+// Appended for GAMEPAD_ANALOG, inside the application collection
+static const uint8_t _analogReportDescriptor[] PROGMEM = {
+    0x05, 0x01,                       // USAGE_PAGE (Generic Desktop)
+    0x09, 0x33,                       // USAGE (Rx)
+    0x09, 0x34,                       // USAGE (Ry)
+    0x15, 0x80,                       // LOGICAL_MINIMUM (-128)
+    0x25, 0x7F,                       // LOGICAL_MAXIMUM (127)
+    0x95, 0x02,                       // REPORT_COUNT (2)
+    0x75, 0x08,                       // REPORT_SIZE (8)
+    0x81, 0x02,                       // INPUT (Data,Var,Abs)
+    0x09, 0x32,                       // USAGE (Z)
+    0x09, 0x35,                       // USAGE (Rz)
+    0x15, 0x00,                       // LOGICAL_MINIMUM (0)
+    0x26, 0xFF, 0x00,                 // LOGICAL_MAXIMUM (255)
+    0x95, 0x02,                       // REPORT_COUNT (2)
+    0x75, 0x08,                       // REPORT_SIZE (8)
+    0x81, 0x02,                       // INPUT (Data,Var,Abs)
+};
+
+// Appended for GAMEPAD_RUMBLE, inside the application collection
+static const uint8_t _rumbleReportDescriptor[] PROGMEM = {
+    0x06, 0x00, 0xFF,                 // USAGE_PAGE (Vendor Defined 0xFF00)
+    0x09, 0x02,                       // USAGE (Rumble)
+    0x15, 0x00,                       // LOGICAL_MINIMUM (0)
+    0x26, 0xFF, 0x00,                 // LOGICAL_MAXIMUM (255)
+    0x95, 0x01,                       // REPORT_COUNT (1)
+    0x75, 0x08,                       // REPORT_SIZE (8)
+    0x91, 0x02,                       // OUTPUT (Data,Var,Abs)
+};
+
+static const uint8_t _endCollection[] PROGMEM = {
   0xc0,                             // END_COLLECTION 
 };
 
-Gamepad_::Gamepad_(void) : PluggableUSBModule(1, 1, epType), protocol(HID_REPORT_PROTOCOL), idle(1)
+static uint16_t descriptorSize(uint8_t features)
+{
+  uint16_t size = sizeof(_hidReportDescriptor) + sizeof(_endCollection);
+
+  if (features & GAMEPAD_ANALOG)
+    size += sizeof(_analogReportDescriptor);
+  if (features & GAMEPAD_RUMBLE)
+    size += sizeof(_rumbleReportDescriptor);
+
+  return size;
+}
+
+Gamepad_::Gamepad_(uint8_t features) : PluggableUSBModule(1, 1, epType), protocol(HID_REPORT_PROTOCOL), idle(1), _lastReportTime(0),
+  _features(features), _rumbleHead(0), _rumbleTail(0), _rumbleLast(0)
 {
   epType[0] = EP_TYPE_INTERRUPT_IN;
   PluggableUSB().plug(this);
@@ -68,7 +130,7 @@ int Gamepad_::getInterface(uint8_t* interfaceCount)
   *interfaceCount += 1; // uses 1
   HIDDescriptor hidInterface = {
     D_INTERFACE(pluggedInterface, 1, USB_DEVICE_CLASS_HUMAN_INTERFACE, HID_SUBCLASS_NONE, HID_PROTOCOL_NONE),
-    D_HIDREPORT(sizeof(_hidReportDescriptor)),
+    D_HIDREPORT(descriptorSize(_features)),
     D_ENDPOINT(USB_ENDPOINT_IN(pluggedEndpoint), USB_ENDPOINT_TYPE_INTERRUPT, USB_EP_SIZE, 0x01)
   };
   return USB_SendControl(0, &hidInterface, sizeof(hidInterface));
@@ -87,7 +149,15 @@ int Gamepad_::getDescriptor(USBSetup& setup)
   // due to the USB specs, but Windows and Linux just assumes its in report mode.
   protocol = HID_REPORT_PROTOCOL;
 
-  return USB_SendControl(TRANSFER_PGM, _hidReportDescriptor, sizeof(_hidReportDescriptor));
+  int total = USB_SendControl(TRANSFER_PGM, _hidReportDescriptor, sizeof(_hidReportDescriptor));
+
+  if (_features & GAMEPAD_ANALOG)
+    total += USB_SendControl(TRANSFER_PGM, _analogReportDescriptor, sizeof(_analogReportDescriptor));
+  if (_features & GAMEPAD_RUMBLE)
+    total += USB_SendControl(TRANSFER_PGM, _rumbleReportDescriptor, sizeof(_rumbleReportDescriptor));
+
+  total += USB_SendControl(TRANSFER_PGM, _endCollection, sizeof(_endCollection));
+  return total;
 }
 
 bool Gamepad_::setup(USBSetup& setup)
@@ -102,11 +172,24 @@ bool Gamepad_::setup(USBSetup& setup)
   if (requestType == REQUEST_DEVICETOHOST_CLASS_INTERFACE)
   {
     if (request == HID_GET_REPORT) {
-      // TODO: HID_GetReport();
+#if (LATENCY_STATS == true)
+      if (setup.wValueH == HID_REPORT_TYPE_FEATURE) {
+        LatencyPortReport report[LAT_PORTS];
+        latencyStats.getReport(report);
+        USB_SendControl(0, report, sizeof(report));
+        return true;
+      }
+#endif
+      if (setup.wValueH != HID_REPORT_TYPE_INPUT) { return false; }
+      USB_SendControl(0, &_lastReport, reportSize());
+      return true;
+    }
+    if (request == HID_GET_IDLE) {
+      USB_SendControl(0, &idle, 1);
       return true;
     }
     if (request == HID_GET_PROTOCOL) {
-      // TODO: Send8(protocol);
+      USB_SendControl(0, &protocol, 1);
       return true;
     }
   }
@@ -118,36 +201,140 @@ bool Gamepad_::setup(USBSetup& setup)
       return true;
     }
     if (request == HID_SET_IDLE) {
-      idle = setup.wValueL;
+      // Duration in 4ms units is the high byte, the low byte is the report ID
+      idle = setup.wValueH;
       return true;
     }
     if (request == HID_SET_REPORT)
     {
+      if ((_features & GAMEPAD_RUMBLE) && setup.wValueH == HID_REPORT_TYPE_OUTPUT && setup.wLength == 1)
+      {
+        uint8_t value;
+        USB_RecvControl(&value, 1);
+        queueRumble(value);
+        return true;
+      }
     }
   }
 
   return false;
 }
 
+uint8_t Gamepad_::getShortName(char *name)
+{
+  if(!next) 
+  {
+    strcpy(name, gp_serial);
+    return strlen(name);
+  }
+  return 0;
+}
+
+void Gamepad_::queueRumble(uint8_t value)
+{
+  // Only changes are queued, hosts may repeat the same state every frame
+  bool on = (value != 0);
+  if (on == _rumbleLast)
+    return;
+
+  uint8_t next = (_rumbleHead + 1) & (GAMEPAD_RUMBLE_QUEUE - 1);
+
+  // Full: the newest request replaces the last queued one
+  if (next == _rumbleTail)
+    next = _rumbleHead;
+  else
+    _rumbleHead = next;
+
+  _rumbleQueue[(next - 1) & (GAMEPAD_RUMBLE_QUEUE - 1)] = on;
+  _rumbleLast = on;
+}
+
+bool Gamepad_::rumbleRequest(bool *on)
+{
+  uint8_t tail = _rumbleTail;
+
+  if (tail == _rumbleHead)
+    return false;
+
+  *on = _rumbleQueue[tail];
+  _rumbleTail = (tail + 1) & (GAMEPAD_RUMBLE_QUEUE - 1);
+  return true;
+}
+
 void Gamepad_::reset()
 {
   _GamepadReport.X = 0;
   _GamepadReport.Y = 0;
   _GamepadReport.buttons = 0;
+  _GamepadReport.Rx = 0;
+  _GamepadReport.Ry = 0;
+  _GamepadReport.Z = 0;
+  _GamepadReport.Rz = 0;
   this->send();
 }
 
-void Gamepad_::send() 
+bool Gamepad_::send() 
 {
-  USB_Send(pluggedEndpoint | TRANSFER_RELEASE, &_GamepadReport, sizeof(GamepadReport));
+  unsigned long now = millis();
+
+  // Idle rate 0 means the report is only sent on change
+  bool idleExpired = (idle != 0) && (now - _lastReportTime >= (unsigned long)idle * 4);
+
+  if (!idleExpired && memcmp(&_GamepadReport, &_lastReport, sizeof(GamepadReport)) == 0)
+    return false;
+
+  // Keep the old report if the device is not configured, so the change is retried
+  if (!writeEndpoint(&_GamepadReport, reportSize()))
+    return false;
+
+  // GET_REPORT reads the cache from the USB interrupt
+  uint8_t sreg = SREG;
+  cli();
+  _lastReport = _GamepadReport;
+  SREG = sreg;
+
+  _lastReportTime = now;
+  return true;
 }
 
-uint8_t Gamepad_::getShortName(char *name)
+// Unlike USB_Send() this never waits for the host. Reports the host did not
+// fetch yet are killed, so only the newest one is pending (drop-oldest) and an
+// interface that is never polled can't stall the scan loop.
+bool Gamepad_::writeEndpoint(const void* data, uint8_t len)
 {
-  if(!next) 
+  if (!USBDevice.configured())
+    return false;
+
+  // The USB interrupt changes UENUM without restoring it
+  uint8_t sreg = SREG;
+  cli();
+
+  UENUM = endpoint();
+
+  while (UESTA0X & ((1 << NBUSYBK1) | (1 << NBUSYBK0)))
   {
-    strcpy(name, gp_serial);
-    return strlen(name);
+    UEINTX |= (1 << KILLBK);
+    while (UEINTX & (1 << KILLBK));
   }
-  return 0;
+
+  const uint8_t* d = (const uint8_t*)data;
+  while (len--)
+    UEDATX = *d++;
+
+  UEINTX = 0x3A; // Release the bank (FIFOCON=0, TXINI=0), same as the core's ReleaseTX()
+
+  SREG = sreg;
+  return true;
+}
+
+bool Gamepad_::delivered(void)
+{
+  uint8_t sreg = SREG;
+  cli();
+
+  UENUM = endpoint();
+  bool empty = !(UESTA0X & ((1 << NBUSYBK1) | (1 << NBUSYBK0)));
+
+  SREG = sreg;
+  return empty;
 }
@@ -26,7 +26,9 @@
 
 #pragma once
 
+#include <stddef.h>
 #include "HID.h"
+#include "LatencyStats.h"
 
 extern const char* gp_serial;
 
@@ -34,27 +36,60 @@ typedef struct {
   uint32_t buttons : 24;
   int8_t X;
   int8_t Y;  
+  int8_t Rx;    // GAMEPAD_ANALOG only
+  int8_t Ry;
+  uint8_t Z;
+  uint8_t Rz;
 } GamepadReport;
 
+// Gamepad_ features
+#define GAMEPAD_RUMBLE  0x01  // Vendor output report (1 byte, non-zero = motor on)
+#define GAMEPAD_ANALOG  0x02  // Second stick (Rx, Ry) and analog triggers (Z, Rz)
+
+#define GAMEPAD_RUMBLE_QUEUE 4  // Power of 2
+
 
 class Gamepad_ : public PluggableUSBModule
 {  
   private:
     uint8_t reportId;
 
+    // Plugged into the USB stack by address, a copy would be left out
+    Gamepad_(const Gamepad_&) = delete;
+    Gamepad_& operator=(const Gamepad_&) = delete;
+
   protected:
     int getInterface(uint8_t* interfaceCount);
     int getDescriptor(USBSetup& setup);
     uint8_t getShortName(char *name);
     bool setup(USBSetup& setup);
+    bool writeEndpoint(const void* data, uint8_t len);
     
     uint8_t epType[1];
     uint8_t protocol;
     uint8_t idle;
+
+    GamepadReport _lastReport;      // Last report handed to the host
+    unsigned long _lastReportTime;
+
+    uint8_t _features;
+    uint8_t reportSize(void) { return (_features & GAMEPAD_ANALOG) ? sizeof(GamepadReport) : offsetof(GamepadReport, Rx); }
+
+    // Rumble changes from SET_REPORT (USB interrupt) to the loop
+    volatile uint8_t _rumbleQueue[GAMEPAD_RUMBLE_QUEUE];
+    volatile uint8_t _rumbleHead;
+    volatile uint8_t _rumbleTail;
+    uint8_t _rumbleLast;
+    void queueRumble(uint8_t value);  // SET_REPORT, from the USB interrupt
     
   public:
     GamepadReport _GamepadReport;
-    Gamepad_(void);
+    Gamepad_(uint8_t features = 0);
     void reset(void);
-    void send();
+    bool send();  // Only transmits on change or when the idle period expired, true if it did
+    uint8_t endpoint(void) { return pluggedEndpoint; }
+    bool delivered(void);  // The host collected every report sent so far
+
+    // Takes the oldest rumble change the host requested, false if there is none
+    bool rumbleRequest(bool *on);
 };
@@ -0,0 +1,199 @@
+/*  LatencyStats.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "LatencyStats.h"
+
+#if (LATENCY_STATS == true)
+
+#include "CycleTimer.h"
+
+enum
+{
+  LAT_IDLE = 0,
+  LAT_PENDING,  // Change seen, not handed to the endpoint yet
+  LAT_IN_FLIGHT // Report written, waiting for the host to fetch it
+};
+
+LatencyStats latencyStats;
+
+// Extends Timer1 to 32 bit, latencies can span more than one 4ms wrap
+static volatile uint16_t timer1Overflows;
+
+ISR(TIMER1_OVF_vect)
+{
+  timer1Overflows++;
+}
+
+LatencyStats::LatencyStats(void)
+{
+  for(uint8_t p = 0; p < LAT_PORTS; p++)
+  {
+    _state[p] = 0;
+    _phase[p] = LAT_IDLE;
+    _count[p] = 0;
+    _min[p] = 0xFFFF;
+    _max[p] = 0;
+    _sum[p] = 0;
+
+    for(uint8_t b = 0; b < LAT_BUCKETS; b++)
+      _histogram[p][b] = 0;
+  }
+}
+
+void LatencyStats::begin(void)
+{
+  cycleTimerInit();
+  TIFR1  = _BV(TOV1);
+  TIMSK1 |= _BV(TOIE1);
+}
+
+uint32_t LatencyStats::now(void)
+{
+  uint8_t sreg = SREG;
+  cli();
+
+  uint16_t low = TCNT1;
+  uint16_t high = timer1Overflows;
+
+  // Overflow happened but its interrupt did not run yet
+  if((TIFR1 & _BV(TOV1)) && low < 0x8000)
+    high++;
+
+  SREG = sreg;
+
+  return ((uint32_t)high << 16) | low;
+}
+
+void LatencyStats::input(uint8_t port, uint32_t state)
+{
+  if(state == _state[port])
+    return;
+
+  _state[port] = state;
+
+  // Only one measurement per port at a time, later changes ride along
+  if(_phase[port] == LAT_IDLE)
+  {
+    _changeTime[port] = now();
+    _phase[port] = LAT_PENDING;
+  }
+}
+
+void LatencyStats::reported(uint8_t port, uint8_t endpoint, bool sent)
+{
+  if(_phase[port] != LAT_PENDING)
+    return;
+
+  // Not sent means the change did not alter the report (deadzone etc.)
+  if(sent)
+  {
+    _endpoint[port] = endpoint;
+    _phase[port] = LAT_IN_FLIGHT;
+  }
+  else
+  {
+    _phase[port] = LAT_IDLE;
+  }
+}
+
+void LatencyStats::poll(void)
+{
+  for(uint8_t p = 0; p < LAT_PORTS; p++)
+  {
+    if(_phase[p] != LAT_IN_FLIGHT)
+      continue;
+
+    // The USB interrupt changes UENUM without restoring it
+    uint8_t sreg = SREG;
+    cli();
+    UENUM = _endpoint[p];
+    bool busy = UESTA0X & ((1 << NBUSYBK1) | (1 << NBUSYBK0));
+    SREG = sreg;
+
+    if(!busy)
+    {
+      record(p, now() - _changeTime[p]);
+      _phase[p] = LAT_IDLE;
+    }
+  }
+}
+
+void LatencyStats::record(uint8_t port, uint32_t cycles)
+{
+  uint32_t us = cycles / CYCLES_PER_US;
+  uint16_t latency = (us > 0xFFFF) ? 0xFFFF : us;
+
+  uint8_t bucket = latency / LAT_BUCKET_US;
+  if(bucket >= LAT_BUCKETS)
+    bucket = LAT_BUCKETS - 1;
+
+  // GET_REPORT reads these from the USB interrupt
+  uint8_t sreg = SREG;
+  cli();
+
+  // Halve everything instead of overflowing, keeps the distribution
+  if(_count[port] == 0xFFFF)
+  {
+    for(uint8_t b = 0; b < LAT_BUCKETS; b++)
+      _histogram[port][b] >>= 1;
+    _count[port] >>= 1;
+    _sum[port] >>= 1;
+  }
+
+  _histogram[port][bucket]++;
+  _count[port]++;
+  _sum[port] += latency;
+
+  if(latency < _min[port]) _min[port] = latency;
+  if(latency > _max[port]) _max[port] = latency;
+
+  SREG = sreg;
+}
+
+void LatencyStats::getReport(LatencyPortReport *report)
+{
+  for(uint8_t p = 0; p < LAT_PORTS; p++)
+  {
+    uint16_t count = _count[p];
+
+    report[p].count = count;
+    report[p].min   = count ? _min[p] : 0;
+    report[p].max   = _max[p];
+    report[p].avg   = count ? _sum[p] / count : 0;
+
+    // Upper edge of the bucket holding the 99th percentile
+    uint16_t rank = count - count / 100;
+    uint16_t seen = 0;
+    uint8_t b;
+
+    for(b = 0; b < LAT_BUCKETS - 1; b++)
+    {
+      seen += _histogram[p][b];
+      if(seen >= rank)
+        break;
+    }
+
+    report[p].p99 = (b == LAT_BUCKETS - 1) ? _max[p] : (b + 1) * LAT_BUCKET_US;
+    if(report[p].p99 > _max[p])
+      report[p].p99 = _max[p];
+  }
+}
+
+#endif
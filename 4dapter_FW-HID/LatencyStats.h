@@ -0,0 +1,97 @@
+/*  LatencyStats.h
+ *
+ *  Measures the time from a scan seeing a new controller state until the
+ *  report carrying it has been fetched by the host, per port. The results
+ *  can be read as a vendor feature report from any of the gamepad interfaces:
+ *  per port (NES, SNES, Genesis, N64) count, min, avg, max and p99 in us,
+ *  all uint16_t little endian.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// 'true' to build in the latency measurement, adds the feature report to the
+// HID descriptor and takes over Timer1 (see CycleTimer.h)
+#ifndef LATENCY_STATS
+#define LATENCY_STATS false
+#endif
+
+#if (LATENCY_STATS == true)
+
+enum
+{
+  LAT_NES = 0,
+  LAT_SNES,
+  LAT_GENESIS,
+  LAT_N64,
+  LAT_PORTS
+};
+
+#define LAT_BUCKETS     16
+#define LAT_BUCKET_US   125  // Histogram resolution, the last bucket collects everything above 1.875ms
+
+typedef struct
+{
+  uint16_t count;
+  uint16_t min;
+  uint16_t avg;
+  uint16_t max;
+  uint16_t p99;
+} LatencyPortReport;
+
+#define LATENCY_REPORT_SIZE (LAT_PORTS * sizeof(LatencyPortReport))
+
+class LatencyStats
+{
+  public:
+    LatencyStats(void);
+    void begin(void);
+
+    // Call after every scan of 'port' with its state packed into 32 bits
+    void input(uint8_t port, uint32_t state);
+
+    // Call after the port's gamepad send(), 'sent' is its return value
+    void reported(uint8_t port, uint8_t endpoint, bool sent);
+
+    // Detects reports fetched by the host, call as often as possible
+    void poll(void);
+
+    void getReport(LatencyPortReport *report);
+
+  private:
+    uint32_t now(void);
+    void record(uint8_t port, uint32_t cycles);
+
+    uint32_t _state[LAT_PORTS];
+    uint32_t _changeTime[LAT_PORTS];
+    uint8_t  _phase[LAT_PORTS];
+    uint8_t  _endpoint[LAT_PORTS];
+
+    uint16_t _histogram[LAT_PORTS][LAT_BUCKETS];
+    uint16_t _count[LAT_PORTS];
+    uint16_t _min[LAT_PORTS];
+    uint16_t _max[LAT_PORTS];
+    uint32_t _sum[LAT_PORTS];
+};
+
+extern LatencyStats latencyStats;
+
+#endif
@@ -11,8 +11,24 @@
 #include "N64_Controller.h"
 #include "Arduino.h"
 
+#if (N64_JOYBUS_TIMER1 == true)
+#include "CycleTimer.h"
+
+// Interrupts only need to be masked while bits are on the wire
+#define JOYBUS_LOCK()
+#define JOYBUS_UNLOCK()
+#else
+#define JOYBUS_LOCK()   noInterrupts()
+#define JOYBUS_UNLOCK() interrupts()
+#endif
+
 N64Controller::N64Controller()
 {
+  memset(&N64_status, 0, sizeof(N64_status));
+  replyBits = 0;
+  controllerType = JOYBUS_NONE;
+  GC_originValid = false;
+  GC_rumble = false;
   rumbleEnabled = false;
   rumblePakDetected = false;
 }
@@ -22,45 +38,131 @@ void N64Controller::N64_init()
   //N64 Setup
   digitalWrite(N64_PIN, LOW);  
   pinMode(N64_PIN, INPUT);
+
+#if (N64_JOYBUS_TIMER1 == true)
+  cycleTimerInit();
+#endif
 }
 
-void N64Controller::translate_N64_data()
+#if (N64_JOYBUS_TIMER1 == true)
+/**
+ * Sends the given byte sequence plus the stop bit, every edge placed relative
+ * to the Timer1 count so the bit cells stay exact regardless of the code path.
+ * Interrupts are masked per byte only, the line idles high in between for as
+ * long as an interrupt takes. That controllers accept such a gap is assumed,
+ * not checked (see N64_JOYBUS_TIMER1). Returns with interrupts masked, ready
+ * to receive the reply; the caller restores SREG afterwards.
+ */
+static void joybusSend(const unsigned char *buffer, uint8_t length)
 {
-    memset(&N64_status, 0, sizeof(N64_status));
-    
-    // line 1
-    // bits: A, B, Z, Start, Dup, Ddown, Dleft, Dright
-    // line 2
-    // bits: Reset, 0, L, R, Cup, Cdown, Cleft, Cright
-    // line 3
-    // bits: joystick x value
-    // These are 8 bit values centered at 0x80 (128)
-    // line 4
-    // bits: joystick 4 value
-    // These are 8 bit values centered at 0x80 (128)
-    
-    for (int i=0; i<8; i++) 
+    uint8_t sreg = SREG;
+
+    while (length--)
     {
-        N64_status.data1 |= N64_raw_dump[i] ? (0x80 >> i) : 0;
-        N64_status.data2 |= N64_raw_dump[8+i] ? (0x80 >> i) : 0;
-        N64_status.stick_x |= N64_raw_dump[16+i] ? (0x80 >> i) : 0;
-        N64_status.stick_y |= N64_raw_dump[24+i] ? (0x80 >> i) : 0;
+        unsigned char data = *buffer++;
+
+        cli();
+        uint16_t start = cycleTimerNow();
+
+        for (uint8_t bits = 8; bits != 0; --bits)
+        {
+            N64_LOW;
+
+            uint16_t low = (data & 0x80) ? JOYBUS_ONE_LOW : JOYBUS_ZERO_LOW;
+            while (cycleTimerSince(start) < low);
+            N64_HIGH;
+
+            data <<= 1;
+            start += JOYBUS_BIT_CYCLES;
+            while (cycleTimerSince(start) >= JOYBUS_BIT_CYCLES); // until 'start' is reached
+        }
+
+        if (length != 0)
+            SREG = sreg;
     }
+
+    // send a single stop (1) bit
+    N64_LOW;
+    uint16_t start = cycleTimerNow();
+    while (cycleTimerSince(start) < JOYBUS_STOP_LOW);
+    N64_HIGH;
 }
 
+/**
+ * Receives up to 'length' bytes into 'reply', every bit shifted in as it
+ * arrives. Each bit is decoded from its measured low time instead of
+ * sampling at a fixed delay. Returns the number of bits received before the
+ * line went quiet, a trailing partial byte is not stored.
+ */
+static uint16_t joybusReceive(unsigned char *reply, uint8_t length)
+{
+    uint16_t start = cycleTimerNow();
+    uint16_t received = 0;
+
+    // the line may still be rising after the stop bit
+    while (!N64_QUERY)
+    {
+        if (cycleTimerSince(start) > JOYBUS_REPLY_TIMEOUT)
+            return 0;
+    }
 
+    while (length--)
+    {
+        unsigned char data = 0;
+
+        for (uint8_t bits = 8; bits != 0; --bits)
+        {
+            start = cycleTimerNow();
+            while (N64_QUERY)
+            {
+                if (cycleTimerSince(start) > JOYBUS_REPLY_TIMEOUT)
+                    return received;
+            }
+
+            uint8_t fall = TCNT1L;
+            uint8_t width;
+            do
+            {
+                width = TCNT1L - fall;
+                if (width > JOYBUS_BIT_CYCLES)
+                    return received;
+            } while (!N64_QUERY);
+
+            data = (data << 1) | (width < JOYBUS_BIT_THRESHOLD);
+            received++;
+        }
+
+        *reply++ = data;
+    }
+
+    return received;
+}
+
+uint16_t N64Controller::N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength)
+{
+    uint8_t sreg = SREG;
+
+    joybusSend(buffer, length);
+    uint16_t received = joybusReceive(reply, replyLength);
+
+    SREG = sreg;
+    return received;
+}
+#else
 /**
- * This sends the given byte sequence to the controller
+ * This sends the given byte sequence to the controller and shifts the reply
+ * straight into 'reply', up to 'replyLength' bytes
  * length must be at least 1
  * Oh, it destroys the buffer passed in as it writes it
+ * Returns the number of reply bits received, a trailing partial byte is not
+ * stored
  */
-void N64Controller::N64_send_data_request(unsigned char *buffer, char length)
+uint16_t N64Controller::N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength)
 {
     char bits;
-    bool bit;
     unsigned char timeout;
-    char bitcount = 32;
-    char *bitbin = N64_raw_dump;
+    unsigned char data = 0;
+    uint16_t received = 0;
 
 
   outer_loop:
@@ -110,14 +212,14 @@ void N64Controller::N64_send_data_request(unsigned char *buffer, char length)
     N64_HIGH;
 
     //////////////////////
-    // listen for the expected 8 bytes of data back from the controller and
-    // blast it out to the N64_raw_dump array, one bit per byte for extra speed.
+    // listen for the reply, every bit is shifted into 'data' as it arrives
+    // and stored once its byte is complete
 
     timeout = 0x7f;
     while (!N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
 
 read_loop:
@@ -127,18 +229,21 @@ read_loop:
     while (N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
 
     //Wait 2us before reading data
     __builtin_avr_delay_cycles(32);
    
-    *bitbin = N64_QUERY;
-    ++bitbin;
-    --bitcount;
+    data = (data << 1) | (N64_QUERY ? 1 : 0);
+    ++received;
     
-    if (bitcount == 0)
-        return;
+    if ((received & 7) == 0)
+    {
+        *reply++ = data;
+        if (--replyLength == 0)
+            return received;
+    }
 
     // wait for line to go high again
     // it may already be high, so this should just drop through
@@ -146,19 +251,218 @@ read_loop:
     while (!N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
     
     goto read_loop;
 }
+#endif
 
 void N64Controller::getN64Packet()
 {
-    unsigned char N64Command[] = {0x01};
-    noInterrupts();
-    N64_send_data_request(N64Command, 1);
-    interrupts();
-    translate_N64_data();
+    // reply bytes:
+    // 1: A, B, Z, Start, Dup, Ddown, Dleft, Dright
+    // 2: Reset, 0, L, R, Cup, Cdown, Cleft, Cright
+    // 3: joystick x value
+    // 4: joystick y value
+    // The joystick values are signed 8 bit, centered at 0
+    unsigned char reply[4];
+
+    // Unknown until a controller answers the identify command
+    if (controllerType == JOYBUS_NONE)
+    {
+        identify();
+
+        if (controllerType == JOYBUS_NONE)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            replyBits = 0;
+            return;
+        }
+    }
+
+    if (controllerType == JOYBUS_GAMECUBE)
+    {
+        getGCPacket();
+        return;
+    }
+
+    // A short or invalid reply (noisy cable, loose plug) is retried once,
+    // after that the last good state is kept. No reply at all means no
+    // controller, which releases everything.
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        unsigned char N64Command[] = {N64_GET_STATUS};
+        JOYBUS_LOCK();
+        replyBits = N64_send_data_request(N64Command, 1, reply, sizeof(reply));
+        JOYBUS_UNLOCK();
+
+        if (replyBits == 0)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            controllerType = JOYBUS_NONE;
+            return;
+        }
+
+        // bit 6 of the second byte is always 0
+        if (replyBits == 32 && !(reply[1] & 0x40))
+        {
+            N64_status.data1   = reply[0];
+            N64_status.data2   = reply[1];
+            N64_status.stick_x = reply[2];
+            N64_status.stick_y = reply[3];
+            return;
+        }
+    }
+}
+
+/**
+ * Asks the controller what it is. The second reply byte and the pak status
+ * in the third are not needed here.
+ */
+void N64Controller::identify()
+{
+    unsigned char command[] = {JOYBUS_IDENTIFY};
+    unsigned char reply[3];
+
+    JOYBUS_LOCK();
+    uint16_t bits = N64_send_data_request(command, 1, reply, sizeof(reply));
+    JOYBUS_UNLOCK();
+
+    if (bits != 24)
+    {
+        controllerType = JOYBUS_NONE;
+    }
+    else if (reply[0] & JOYBUS_TYPE_GAMECUBE)
+    {
+        controllerType = JOYBUS_GAMECUBE;
+        GC_originValid = getGCOrigin();
+    }
+    else
+    {
+        controllerType = JOYBUS_N64;
+    }
+}
+
+static unsigned char gcCenter(unsigned char value, unsigned char origin)
+{
+    int16_t centered = (int16_t)value - origin + 128;
+
+    if (centered < 0)
+        return 0;
+    if (centered > 255)
+        return 255;
+    return centered;
+}
+
+static unsigned char gcTrigger(unsigned char value, unsigned char origin, bool clicked)
+{
+    if (clicked)
+        return 255;
+    return (value > origin) ? value - origin : 0;
+}
+
+/**
+ * The rest position of the GameCube pad's sticks and triggers. The reply has
+ * the layout of a poll reply plus two unused bytes. Until it got this
+ * command the pad keeps GC_BTN_ORIGIN set in its polls, after power up and
+ * after X + Y + Start.
+ */
+bool N64Controller::getGCOrigin()
+{
+    unsigned char command[] = {GC_ORIGIN};
+    unsigned char reply[GC_ORIGIN_REPLY_SIZE];
+
+    JOYBUS_LOCK();
+    uint16_t bits = N64_send_data_request(command, 1, reply, sizeof(reply));
+    JOYBUS_UNLOCK();
+
+    if (bits != sizeof(reply) * 8 || (reply[0] & 0x80) || !(reply[1] & 0x80))
+        return false;
+
+    memcpy(&GC_origin, reply, sizeof(GC_origin));
+    return true;
+}
+
+void N64Controller::getGCPacket()
+{
+    // reply bytes:
+    // 1: 0, 0, Origin, Start, Y, X, B, A
+    // 2: 1, L, R, Z, Dup, Ddown, Dright, Dleft
+    // 3, 4: main stick x, y
+    // 5, 6: C-stick x, y
+    // 7, 8: L, R analog
+    // Sticks are unsigned, centered near 128
+    unsigned char reply[8];
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        unsigned char command[] = {GC_POLL, GC_POLL_MODE, GC_rumble};
+        JOYBUS_LOCK();
+        replyBits = N64_send_data_request(command, sizeof(command), reply, sizeof(reply));
+        JOYBUS_UNLOCK();
+
+        if (replyBits == 0)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            controllerType = JOYBUS_NONE;
+            GC_rumble = false;
+            return;
+        }
+
+        // bit 7 of the first byte is the error flag, of the second always 1
+        if (replyBits == 64 && !(reply[0] & 0x80) && (reply[1] & 0x80))
+        {
+            // Sticks and triggers are relative to the origin the pad reports,
+            // like on the console. A pad without the origin command rests
+            // where it was at its first poll.
+            if (reply[0] & GC_BTN_ORIGIN)
+                GC_originValid = getGCOrigin() || GC_originValid;
+
+            if (!GC_originValid)
+            {
+                memcpy(&GC_origin, reply, sizeof(GC_origin));
+                GC_originValid = true;
+            }
+
+            GC_status.buttons1  = reply[0];
+            GC_status.buttons2  = reply[1];
+            GC_status.stick_x   = gcCenter(reply[2], GC_origin.stick_x);
+            GC_status.stick_y   = gcCenter(reply[3], GC_origin.stick_y);
+            GC_status.cstick_x  = gcCenter(reply[4], GC_origin.cstick_x);
+            GC_status.cstick_y  = gcCenter(reply[5], GC_origin.cstick_y);
+            GC_status.trigger_l = gcTrigger(reply[6], GC_origin.trigger_l, reply[1] & GC_BTN_L);
+            GC_status.trigger_r = gcTrigger(reply[7], GC_origin.trigger_r, reply[1] & GC_BTN_R);
+
+            gcToN64();
+            return;
+        }
+    }
+}
+
+// The GameCube pad as far as an N64 controller has the same controls
+void N64Controller::gcToN64()
+{
+    unsigned char buttons1 = GC_status.buttons1;
+    unsigned char buttons2 = GC_status.buttons2;
+
+    N64_status.data1 = (buttons1 & GC_BTN_A      ? 0x80 : 0) |
+                       (buttons1 & GC_BTN_B      ? 0x40 : 0) |
+                       (buttons2 & GC_BTN_Z      ? 0x20 : 0) |
+                       (buttons1 & GC_BTN_START  ? 0x10 : 0) |
+                       (buttons2 & (GC_BTN_DUP | GC_BTN_DDOWN)) |
+                       (buttons2 & GC_BTN_DLEFT  ? 0x02 : 0) |
+                       (buttons2 & GC_BTN_DRIGHT ? 0x01 : 0);
+
+    N64_status.data2 = (buttons2 & GC_BTN_L ? 0x20 : 0) |
+                       (buttons2 & GC_BTN_R ? 0x10 : 0) |
+                       (GC_status.cstick_y >= 128 + GC_C_THRESHOLD ? 0x08 : 0) |
+                       (GC_status.cstick_y <= 128 - GC_C_THRESHOLD ? 0x04 : 0) |
+                       (GC_status.cstick_x <= 128 - GC_C_THRESHOLD ? 0x02 : 0) |
+                       (GC_status.cstick_x >= 128 + GC_C_THRESHOLD ? 0x01 : 0);
+
+    N64_status.stick_x = GC_status.stick_x - 128;
+    N64_status.stick_y = GC_status.stick_y - 128;
 }
 
 /**
@@ -189,6 +493,13 @@ bool N64Controller::initializeRumblePak()
 
 void N64Controller::setRumble(bool enable)
 {
+    // GameCube pads take the motor state with every poll
+    if (controllerType == JOYBUS_GAMECUBE)
+    {
+        GC_rumble = enable;
+        return;
+    }
+
     if (!rumblePakDetected) {
         // Try to initialize rumble pak if not detected yet
         if (!checkRumblePak()) return;
@@ -213,124 +524,105 @@ void N64Controller::setRumble(bool enable)
 
 bool N64Controller::writeMemoryPak(unsigned short address, unsigned char* data, int length)
 {
-    // Based on raphnet N64 expansion write protocol
-    // Command format: [0x03][addr_hi][addr_lo][32_bytes_data]
-    unsigned char command[35]; // 1 + 2 + 32 bytes
-    
-    command[0] = N64_EXPANSION_WRITE;             // 0x03 (raphnet standard)
-    command[1] = (address >> 8) & 0xFF;          // Address high byte  
-    command[2] = address & 0xFF;                 // Address low byte
-    
-    // Copy data to command buffer (always 32 bytes for rumble pak)
-    if (data != NULL && length > 0) {
-        memcpy(&command[3], data, min(length, 32));
-        // Fill remaining bytes with zeros if length < 32
-        if (length < 32) {
-            memset(&command[3 + length], 0x00, 32 - length);
-        }
-    } else {
-        // Default: all zeros (rumble off)
-        memset(&command[3], 0x00, 32);
-    }
-    
-    // Send the command with precise timing
-    noInterrupts();
-    sendRumbleCommand(command, 35);
-    interrupts();
-    
-    return true; // Raphnet implementation assumes success
+    // Always a full block, the rest is filled with zeros
+    unsigned char block[N64_PAK_BLOCK_SIZE];
+    memset(block, 0x00, sizeof(block));
+
+    if (data != NULL && length > 0)
+        memcpy(block, data, min(length, N64_PAK_BLOCK_SIZE));
+
+    return writePakBlock(address, block) == N64_PAK_OK;
 }
 
-void N64Controller::sendRumbleCommand(unsigned char* buffer, int length)
-{
-    // Create a copy since the original function destroys the buffer
-    unsigned char temp_buffer[35];
-    memcpy(temp_buffer, buffer, length);
-    
-    // Use EXACT same timing as working N64_send_data_request function for sending
-    char bits;
-    unsigned char *current_buffer = temp_buffer;
-    
-    // SEND PHASE - exactly like N64_send_data_request
-    // Outer loop for each byte
-    for (int i = 0; i < length; i++) {
-        bits = 8;
-        
-        // Inner loop for each bit in the byte
-        while (bits != 0) {
-            // Starting a bit, set the line low
-            N64_LOW;
+/**
+ * Controller Pak Access
+ * Reads and writes move one 32 byte block. The controller checks the 5 bit
+ * address checksum and answers with the CRC of the data, inverted when no
+ * pak is inserted.
+ */
 
-            if (*current_buffer >> 7) // Bit is a 1
-            {
-                __builtin_avr_delay_cycles(5);
-                N64_HIGH;
-                __builtin_avr_delay_cycles(40);
-            } 
-            else  // Bit is a 0
-            {
-                 __builtin_avr_delay_cycles(40);
-                N64_HIGH;
-            }
-            
-            --bits;
-            if (bits != 0) 
-            {
-                __builtin_avr_delay_cycles(8);
-                *current_buffer <<= 1;
-            }
-        }
-        
-        // Move to next byte
-        ++current_buffer;
-    }
+unsigned short N64Controller::pakAddress(unsigned short address)
+{
+    static const uint8_t xorTable[11] = { 0x15, 0x1F, 0x0B, 0x16, 0x19, 0x07, 0x0E, 0x1C, 0x0D, 0x1A, 0x01 };
+    uint8_t crc = 0;
 
-    // Send a single stop (1) bit - same as original
-    __builtin_avr_delay_cycles(8);
-    N64_LOW;
-    __builtin_avr_delay_cycles(16);
-    N64_HIGH;
+    address &= 0xFFE0;
 
-    // READ PHASE - Read 1-byte response (8 bits) from expansion write
-    // Based on raphnet: expansion write returns 1 byte status
-    unsigned char timeout;
-    
-    // Wait for controller to start response
-    timeout = 0x7f;
-    while (!N64_QUERY) 
+    for (uint8_t bit = 0; bit < 11; bit++)
     {
-        if (!--timeout)
-            return; // Timeout - no response
+        if (address & (0x20 << bit))
+            crc ^= xorTable[bit];
     }
 
-    // Read 8 bits (1 byte) response
-    unsigned char response_byte = 0;
-    for (int bit = 7; bit >= 0; bit--) {
-        // Wait for line to go low (start of bit)
-        timeout = 0x7f;
-        while (N64_QUERY) 
-        {
-            if (!--timeout)
-                return;
-        }
+    return address | crc;
+}
 
-        // Wait 2us before reading data
-        __builtin_avr_delay_cycles(32);
-       
-        // Read bit value and store in response_byte
-        if (N64_QUERY) {
-            response_byte |= (1 << bit);
-        }
+uint8_t N64Controller::pakDataCrc(const unsigned char *data)
+{
+    uint8_t crc = 0;
 
-        // Wait for line to go high again
-        timeout = 0x3f;
-        while (!N64_QUERY) 
+    for (uint8_t i = 0; i <= N64_PAK_BLOCK_SIZE; i++)
+    {
+        for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
         {
-            if (!--timeout)
-                return;
+            uint8_t xorTap = (crc & 0x80) ? 0x85 : 0x00;
+            crc <<= 1;
+            if (i < N64_PAK_BLOCK_SIZE && (data[i] & mask))
+                crc |= 1;
+            crc ^= xorTap;
         }
     }
-    
-    // Response received successfully
-    // According to raphnet: response should be 1 byte status (0x00 = success)
+
+    return crc;
+}
+
+static uint8_t pakReplyStatus(uint8_t received, uint8_t expected)
+{
+    if (received == expected)
+        return N64_PAK_OK;
+
+    if (received == (uint8_t)~expected)
+        return N64_PAK_NO_PAK;
+
+    return N64_PAK_CRC_ERROR;
+}
+
+uint8_t N64Controller::readPakBlock(unsigned short address, unsigned char *data)
+{
+    // Command format: [0x02][addr_hi][addr_lo], reply: [32_bytes_data][crc]
+    unsigned short field = pakAddress(address);
+    unsigned char command[3] = { N64_EXPANSION_READ, (unsigned char)(field >> 8), (unsigned char)field };
+    unsigned char reply[N64_PAK_BLOCK_SIZE + 1];
+
+    JOYBUS_LOCK();
+    uint16_t bits = N64_send_data_request(command, sizeof(command), reply, sizeof(reply));
+    JOYBUS_UNLOCK();
+
+    if (bits != sizeof(reply) * 8)
+        return N64_PAK_NO_REPLY;
+
+    memcpy(data, reply, N64_PAK_BLOCK_SIZE);
+    return pakReplyStatus(reply[N64_PAK_BLOCK_SIZE], pakDataCrc(data));
+}
+
+uint8_t N64Controller::writePakBlock(unsigned short address, const unsigned char *data)
+{
+    // Command format: [0x03][addr_hi][addr_lo][32_bytes_data], reply: [crc]
+    unsigned short field = pakAddress(address);
+    unsigned char command[3 + N64_PAK_BLOCK_SIZE];
+    unsigned char crc;
+
+    command[0] = N64_EXPANSION_WRITE;
+    command[1] = field >> 8;
+    command[2] = field & 0xFF;
+    memcpy(&command[3], data, N64_PAK_BLOCK_SIZE);
+
+    JOYBUS_LOCK();
+    uint16_t bits = N64_send_data_request(command, sizeof(command), &crc, 1);
+    JOYBUS_UNLOCK();
+
+    if (bits != 8)
+        return N64_PAK_NO_REPLY;
+
+    return pakReplyStatus(crc, pakDataCrc(data));
 }
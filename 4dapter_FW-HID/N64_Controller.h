@@ -23,6 +23,27 @@
 #define N64_LOW      DDRB |=  B01000000
 #define N64_QUERY   (PINB &   B01000000)
 
+// 'true' to time the Joybus against Timer1 (see CycleTimer.h) instead of
+// cycle counted delays. Interrupts then stay enabled between command bytes,
+// which keeps USB serviced during long Controller Pak writes.
+// Experimental: a USB interrupt between two command bytes holds the line
+// idle high for tens of us, and whether N64 pads and paks accept such a gap
+// in the middle of a command has not been checked on hardware. Replies are
+// still received with interrupts masked, so a poll blocks USB as long as
+// with the default driver.
+#ifndef N64_JOYBUS_TIMER1
+#define N64_JOYBUS_TIMER1 false
+#endif
+
+#if (N64_JOYBUS_TIMER1 == true)
+#define JOYBUS_BIT_CYCLES       64  // 4us bit cell
+#define JOYBUS_ONE_LOW          16  // 1us low for a 1
+#define JOYBUS_ZERO_LOW         48  // 3us low for a 0
+#define JOYBUS_STOP_LOW         16  // 1us low for the console stop bit
+#define JOYBUS_BIT_THRESHOLD    32  // Received low time below 2us is a 1
+#define JOYBUS_REPLY_TIMEOUT    1024 // 64us without an edge ends the transfer
+#endif
+
 // 8 bytes of data that we get from the controller
 typedef struct state
 {
@@ -36,40 +57,119 @@ typedef struct state
     unsigned char data2;
 } N64_status_packet;
 
+// GameCube poll reply, the sticks origin corrected and centered at 128
+typedef struct
+{
+    // bits: 0, 0, origin, start, y, x, b, a
+    unsigned char buttons1;
+
+    // bits: 1, L, R, Z, Dup, Ddown, Dright, Dleft
+    unsigned char buttons2;
+
+    unsigned char stick_x;
+    unsigned char stick_y;
+    unsigned char cstick_x;
+    unsigned char cstick_y;
+    unsigned char trigger_l;  // 255 once the trigger clicks
+    unsigned char trigger_r;
+} GC_status_packet;
+
+#define GC_BTN_A        0x01  // buttons1
+#define GC_BTN_B        0x02
+#define GC_BTN_X        0x04
+#define GC_BTN_Y        0x08
+#define GC_BTN_START    0x10
+#define GC_BTN_ORIGIN   0x20  // Set until the pad got GC_ORIGIN, after power up and X + Y + Start
+#define GC_BTN_DLEFT    0x01  // buttons2
+#define GC_BTN_DRIGHT   0x02
+#define GC_BTN_DDOWN    0x04
+#define GC_BTN_DUP      0x08
+#define GC_BTN_Z        0x10
+#define GC_BTN_R        0x20
+#define GC_BTN_L        0x40
+
+#define GC_C_THRESHOLD  48    // C-stick travel that presses the N64 C buttons
+
+// What getN64Packet() found on the port
+enum
+{
+  JOYBUS_NONE = 0,
+  JOYBUS_N64,
+  JOYBUS_GAMECUBE
+};
+
 // N64 Expansion/Memory Pak commands (raphnet standard)
 #define N64_EXPANSION_READ      0x02
 #define N64_EXPANSION_WRITE     0x03
 #define N64_GET_STATUS          0x01
+#define JOYBUS_IDENTIFY         0x00
+#define GC_POLL                 0x40      // Followed by the mode and the rumble byte
+#define GC_POLL_MODE            0x03      // 8 bit sticks and triggers
+#define GC_ORIGIN               0x41      // Rest position, clears GC_BTN_ORIGIN
+#define GC_ORIGIN_REPLY_SIZE    10
+#define JOYBUS_TYPE_GAMECUBE    0x08      // Set in the first identify byte of GameCube devices
 
 // Rumble Pak addresses (from raphnet implementation)
 #define RUMBLEPAK_INIT_ADDRESS  0x8001    // Initialization address
 #define RUMBLEPAK_CTRL_ADDRESS  0xC01B    // Control address for rumble on/off
 
+#define N64_PAK_BLOCK_SIZE      32
+#define N64_PAK_SIZE            0x8000    // Controller Pak, 32KB
+
+// Result of a pak block access
+enum
+{
+  N64_PAK_OK = 0,
+  N64_PAK_NO_REPLY,     // No controller or a cut off reply
+  N64_PAK_NO_PAK,       // The controller answered with the inverted data CRC
+  N64_PAK_CRC_ERROR     // Corrupted on the wire
+};
+
 class N64Controller 
 {
   public:  
     N64Controller();
     void N64_init();
-    void translate_N64_data();
     void N64_get_data_from_controller();
-    void N64_send_data_request(unsigned char *buffer, char length);
+    uint16_t N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength);
     void print_N64_status();
     void getN64Packet();
     N64_status_packet N64_status;
+    uint8_t replyBits; // Bits of the last status reply, 32 when complete (64 for GameCube)
+
+    // A GameCube pad is identified on connect and polled instead. N64_status
+    // then carries its A, B, Z, Start, D-pad, L, R and main stick as N64
+    // buttons, the C-stick as C buttons, GC_status has everything.
+    uint8_t controllerType;
+    GC_status_packet GC_status;
     
     // Rumble Pak support functions  
     bool checkRumblePak();
     bool initializeRumblePak();
     void setRumble(bool enable);
     bool writeMemoryPak(unsigned short address, unsigned char* data, int length);
-    void sendRumbleCommand(unsigned char* buffer, int length);
+
+    // Expansion port access in 32 byte blocks, returns N64_PAK_*. The low 5
+    // bits of 'address' are replaced by its checksum.
+    uint8_t readPakBlock(unsigned short address, unsigned char *data);
+    uint8_t writePakBlock(unsigned short address, const unsigned char *data);
+
+    static unsigned short pakAddress(unsigned short address); // Address with its 5 bit checksum
+    static uint8_t pakDataCrc(const unsigned char *data);     // CRC of a 32 byte block, poly 0x85
     
     // Rumble Pak variables
     bool rumbleEnabled;
     bool rumblePakDetected;
 
   private:
-    char N64_raw_dump[33]; // 1 received bit per byte
+    void identify();
+    void getGCPacket();
+    bool getGCOrigin();
+    void gcToN64();
+
+    GC_status_packet GC_origin;
+    bool GC_originValid;
+    bool GC_rumble;
 };
 
 #endif
@@ -0,0 +1,139 @@
+/*  PakTransfer.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "PakTransfer.h"
+
+#if (PAK_TRANSFER == true)
+
+#define PAK_INDEX(i) ((i) & (PAK_QUEUE_SIZE - 1))
+
+// Keeps the block contents ahead of the index that hands them over
+#define PAK_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+PakTransfer_::PakTransfer_(N64Controller &controller) : PluggableUSBModule(0, 1, NULL), _controller(controller), _head(0), _done(0), _tail(0), _attempts(0)
+{
+  PluggableUSB().plug(this);
+}
+
+int PakTransfer_::getInterface(uint8_t* interfaceCount)
+{
+  *interfaceCount += 1; // uses 1
+  InterfaceDescriptor pakInterface = D_INTERFACE(pluggedInterface, 0, PAK_INTERFACE_CLASS, PAK_INTERFACE_SUBCLASS, PAK_INTERFACE_PROTOCOL);
+  return USB_SendControl(0, &pakInterface, sizeof(pakInterface));
+}
+
+int PakTransfer_::getDescriptor(USBSetup& setup)
+{
+  return 0;
+}
+
+bool PakTransfer_::setup(USBSetup& setup)
+{
+  if (setup.wIndex != pluggedInterface || (setup.bmRequestType & REQUEST_TYPE) != REQUEST_VENDOR)
+    return false;
+
+  uint8_t request = setup.bRequest;
+  uint8_t head = _head;
+
+  if (request == PAK_REQ_READ || request == PAK_REQ_WRITE)
+  {
+    // Full: stall, the host collects a result and queues again
+    if ((uint8_t)(head - _tail) == PAK_QUEUE_SIZE)
+      return false;
+
+    PakBlock &block = _queue[PAK_INDEX(head)];
+    block.write = (request == PAK_REQ_WRITE);
+    block.address = setup.wValueL | (setup.wValueH << 8);
+
+    if (block.write)
+    {
+      if (setup.wLength != N64_PAK_BLOCK_SIZE)
+        return false;
+      USB_RecvControl(block.data, N64_PAK_BLOCK_SIZE);
+    }
+
+    PAK_BARRIER();
+    _head = head + 1;
+    return true;
+  }
+
+  if (request == PAK_REQ_RESULT)
+  {
+    PakResult result;
+    uint8_t tail = _tail;
+
+    result.status = PAK_STATUS_IDLE;
+    result.result = N64_PAK_OK;
+    result.address = 0;
+
+    if (tail != _done)
+    {
+      PakBlock &block = _queue[PAK_INDEX(tail)];
+      result.status = PAK_STATUS_DONE;
+      result.result = block.result;
+      result.address = block.address;
+      memcpy(result.data, block.data, N64_PAK_BLOCK_SIZE);
+      PAK_BARRIER();
+      _tail = tail + 1;
+    }
+    else if (tail != head)
+    {
+      result.status = PAK_STATUS_BUSY;
+    }
+
+    if (result.status != PAK_STATUS_DONE)
+      memset(result.data, 0, N64_PAK_BLOCK_SIZE);
+
+    return USB_SendControl(0, &result, sizeof(result)) >= 0;
+  }
+
+  return false;
+}
+
+bool PakTransfer_::service(void)
+{
+  uint8_t done = _done;
+
+  if (done == _head)
+    return false;
+
+  PAK_BARRIER();
+  PakBlock &block = _queue[PAK_INDEX(done)];
+
+  if (block.write)
+    block.result = _controller.writePakBlock(block.address, block.data);
+  else
+    block.result = _controller.readPakBlock(block.address, block.data);
+
+  // A corrupted transfer is repeated in the following passes, a missing
+  // controller or pak is final
+  if (block.result == N64_PAK_CRC_ERROR && _attempts < PAK_RETRIES)
+  {
+    _attempts++;
+    return true;
+  }
+
+  _attempts = 0;
+  PAK_BARRIER();
+  _done = done + 1;
+  return true;
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*  PakTransfer.h
+ *
+ *  Controller Pak backup/restore over a vendor specific USB interface.
+ *  The host queues block reads and writes with control requests, the main
+ *  loop carries out one of them per pass between the controller polls and
+ *  the host collects the results in order. See tools/n64pak for the host
+ *  side.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// 'true' to build in the vendor interface. Hosts without a driver for it
+// (Windows) list it as an unknown device, so it is off by default.
+#ifndef PAK_TRANSFER
+#define PAK_TRANSFER false
+#endif
+
+#if (PAK_TRANSFER == true)
+
+#include "PluggableUSB.h"
+#include "N64_Controller.h"
+
+// Interface class/subclass/protocol the host tool looks for
+#define PAK_INTERFACE_CLASS     0xFF
+#define PAK_INTERFACE_SUBCLASS  0x64
+#define PAK_INTERFACE_PROTOCOL  0x01
+
+// Vendor requests, wIndex is the interface number
+enum
+{
+  PAK_REQ_READ = 0x01,  // OUT, wValue = block address, no data
+  PAK_REQ_WRITE,        // OUT, wValue = block address, 32 bytes of data
+  PAK_REQ_RESULT        // IN, PakResult of the oldest queued block
+};
+
+// PakResult.status
+enum
+{
+  PAK_STATUS_IDLE = 0,  // Nothing queued
+  PAK_STATUS_BUSY,      // The oldest block is not done yet
+  PAK_STATUS_DONE       // Done, 'result' holds N64_PAK_*; the block is dequeued
+};
+
+#define PAK_QUEUE_SIZE  4  // Power of 2, blocks the host can have in flight
+#define PAK_RETRIES     2  // Extra attempts after a corrupted transfer
+
+typedef struct
+{
+  uint8_t  status;
+  uint8_t  result;
+  uint16_t address;
+  uint8_t  data[N64_PAK_BLOCK_SIZE]; // Read data, unused for writes
+} PakResult;
+
+class PakTransfer_ : public PluggableUSBModule
+{
+  public:
+    PakTransfer_(N64Controller &controller);
+
+    // One queued block access, call between the controller polls. Returns
+    // true if it used the Joybus.
+    bool service(void);
+
+  protected:
+    int getInterface(uint8_t* interfaceCount);
+    int getDescriptor(USBSetup& setup);
+    bool setup(USBSetup& setup);
+
+  private:
+    typedef struct
+    {
+      uint8_t  write;
+      uint8_t  result;
+      uint16_t address;
+      uint8_t  data[N64_PAK_BLOCK_SIZE];
+    } PakBlock;
+
+    N64Controller &_controller;
+
+    // _tail <= _done <= _head. The USB interrupt queues at _head and hands
+    // results out at _tail, the loop works on _done.
+    PakBlock _queue[PAK_QUEUE_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _done;
+    volatile uint8_t _tail;
+    uint8_t _attempts;        // Retries of the block at _done so far
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*  PhaseProfiler.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "PhaseProfiler.h"
+
+#if (PROFILE_PHASES == true)
+
+#include "CycleTimer.h"
+
+// 10 fields of up to 5 digits plus separators, fits one CDC packet
+#define PROF_LINE_MAX (10 * 6)
+
+PhaseProfiler phaseProfiler;
+
+PhaseProfiler::PhaseProfiler(void)
+{
+  _phase = PROF_WAIT;
+  _markTime = 0;
+  _passStart = 0;
+  _running = false;
+  _head = 0;
+  _tail = 0;
+
+  _record.sequence = 0;
+  _record.dropped = 0;
+  for(uint8_t p = 0; p < PROF_PHASES; p++)
+    _record.cycles[p] = 0;
+}
+
+void PhaseProfiler::begin(void)
+{
+  cycleTimerInit();
+}
+
+void PhaseProfiler::mark(uint8_t phase)
+{
+  uint16_t now = cycleTimerNow();
+
+  _record.cycles[_phase] = now - _markTime;
+  _markTime = now;
+  _phase = phase;
+
+  if(phase != PROF_WAIT)
+    return;
+
+  uint32_t passStart = micros();
+  uint32_t passUs = passStart - _passStart;
+  _passStart = passStart;
+
+  // The first mark only starts the clock
+  if(!_running)
+  {
+    _running = true;
+    return;
+  }
+
+  _record.loopUs = (passUs > 0xFFFF) ? 0xFFFF : passUs;
+
+  uint8_t next = (_head + 1) & (PROF_RING_SIZE - 1);
+
+  if(next == _tail)
+  {
+    _record.dropped++;
+  }
+  else
+  {
+    _ring[_head] = _record;
+    _head = next;
+  }
+
+  _record.sequence++;
+}
+
+static char *appendNumber(char *out, uint16_t value, char separator)
+{
+  utoa(value, out, 10);
+  while(*out)
+    out++;
+
+  *out++ = separator;
+  return out;
+}
+
+void PhaseProfiler::flush(void)
+{
+  uint8_t tail = _tail;
+
+  if(tail == _head)
+    return;
+
+  // Nobody listening, don't let stale passes pile up
+  if(!Serial.dtr())
+  {
+    _tail = _head;
+    return;
+  }
+
+  // Wait for the next SOF to empty the bank instead of blocking in write()
+  if(Serial.availableForWrite() < PROF_LINE_MAX)
+    return;
+
+  const PhaseRecord *record = &_ring[tail];
+  char line[PROF_LINE_MAX];
+  char *out = line;
+
+  out = appendNumber(out, record->sequence, ' ');
+  for(uint8_t p = 0; p < PROF_PHASES; p++)
+    out = appendNumber(out, record->cycles[p], ' ');
+  out = appendNumber(out, record->loopUs, ' ');
+  out = appendNumber(out, record->dropped, '\n');
+
+  Serial.write((const uint8_t *)line, out - line);
+  _tail = (tail + 1) & (PROF_RING_SIZE - 1);
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*  PhaseProfiler.h
+ *
+ *  Times the phases of every loop pass with Timer1 (see CycleTimer.h) and
+ *  streams the results over the CDC serial port the Leonardo core exposes
+ *  next to the gamepads. Open the port (any baud rate) and every pass
+ *  arrives as one text line of space separated decimals:
+ *
+ *    seq wait genesis nessnes n64 send_nes send_genesis send_n64 loop_us dropped
+ *
+ *  seq counts passes, so gaps show lost lines. The phase values are CPU
+ *  cycles (16 per us) and wrap for phases longer than 4ms. loop_us is the
+ *  whole pass in us, and dropped counts the passes lost because the
+ *  ring buffer was full.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// 'true' to build in the phase profiler, shares Timer1 (see CycleTimer.h)
+#ifndef PROFILE_PHASES
+#define PROFILE_PHASES false
+#endif
+
+#if (PROFILE_PHASES == true)
+
+// A phase lasts from its mark until the next one
+enum
+{
+  PROF_WAIT = 0,      // Loop start, waiting for the scan slot
+  PROF_GENESIS,       // Genesis select cycles with the NES/SNES bits clocked in between
+  PROF_NESSNES,       // Rest of the NES/SNES scan, NES/SNES and Genesis mapping
+  PROF_N64,           // getN64Packet() and the N64 mapping
+  PROF_SEND_NES,      // Gamepad[0].send()
+  PROF_SEND_GENESIS,  // Gamepad[1].send()
+  PROF_SEND_N64,      // Gamepad[2].send() and the rest of the pass
+  PROF_PHASES
+};
+
+#define PROF_RING_SIZE  16  // Loop passes, power of 2
+
+typedef struct
+{
+  uint16_t sequence;
+  uint16_t cycles[PROF_PHASES];
+  uint16_t loopUs;
+  uint16_t dropped;
+} PhaseRecord;
+
+class PhaseProfiler
+{
+  public:
+    PhaseProfiler(void);
+    void begin(void);
+
+    // Ends the running phase and starts 'phase', PROF_WAIT also ends the pass
+    void mark(uint8_t phase);
+
+    // Sends at most one pass if the CDC endpoint has room, never blocks.
+    // Call while idle.
+    void flush(void);
+
+  private:
+    PhaseRecord _record;
+    uint8_t  _phase;
+    uint16_t _markTime;
+    uint32_t _passStart;
+    bool     _running;
+
+    // Single producer (mark) / single consumer (flush), each index is only
+    // written by its side
+    PhaseRecord _ring[PROF_RING_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+};
+
+extern PhaseProfiler phaseProfiler;
+
+#define PROFILE_PHASE(phase) phaseProfiler.mark(phase)
+
+#else
+
+#define PROFILE_PHASE(phase)
+
+#endif
@@ -62,6 +62,8 @@ SegaController32U4::SegaController32U4(int eeprom_index)
     _misterMode = (EEPROM.read(_eeprom_index) == kMisterModeChar);
     _connected = 0;
     _sixButtonMode = false;
+    _sixButtonRead = false;
+    _sixButtonPad = false;
     _ignoreCycles = 0;
     _pinSelect = true;
 }
@@ -88,6 +90,23 @@ static void doSwapbuttons(word *state, int btn_1, int btn_2) {
 
 
 word SegaController32U4::updateState()
+{
+  toggleSelect();
+
+  // Short delay to stabilise outputs in controller
+  delayMicroseconds(SC_CYCLE_DELAY);
+
+  return readState();
+}
+
+void SegaController32U4::toggleSelect()
+{
+  // Set the select pin low/high
+  _pinSelect = !_pinSelect;
+  (!_pinSelect) ? PORT_SELECT &= ~MASK_SELECT : PORT_SELECT |= MASK_SELECT; // Set LOW on even cycle, HIGH on uneven cycle
+}
+
+word SegaController32U4::readState()
 {
   // "Normal" Six button controller reading routine, done a bit differently in this project
   // Cycle  TH out  TR in  TL in  D3 in  D2 in  D1 in  D0 in
@@ -100,13 +119,6 @@ word SegaController32U4::updateState()
   // 6      LO      ---    ---    ---    ---    ---    Home    (Home only for 8bitdo wireless gamepads)      
   // 7      HI      ---    ---    ---    ---    ---    ---    
 
-  // Set the select pin low/high
-  _pinSelect = !_pinSelect;
-  (!_pinSelect) ? PORT_SELECT &= ~MASK_SELECT : PORT_SELECT |= MASK_SELECT; // Set LOW on even cycle, HIGH on uneven cycle
-
-  // Short delay to stabilise outputs in controller
-  delayMicroseconds(SC_CYCLE_DELAY);
-
   // Read input register(s)
   _inputReg1 = PINF;
   _inputReg2 = PINB;
@@ -128,6 +140,7 @@ word SegaController32U4::updateState()
           (bitRead(_inputReg1, DB9_PIN3_BIT) == LOW) ? _currentState |= SC_BTN_X : _currentState &= ~SC_BTN_X;
           (bitRead(_inputReg1, DB9_PIN4_BIT) == LOW) ? _currentState |= SC_BTN_MODE : _currentState &= ~SC_BTN_MODE;
           _sixButtonMode = false;
+          _sixButtonRead = true;
           _ignoreCycles = 2; // Ignore the two next cycles (cycles 6 and 7 in table above)
         }
         else
@@ -185,6 +198,12 @@ word SegaController32U4::updateState()
   return _currentState;
 }
 
+boolean SegaController32U4::inputActive()
+{
+  return (PINF & B00110000) != B00110000 || (PINB & B00001010) != B00001010 ||
+         (PINC & B01000000) != B01000000 || (PIND & B10000000) != B10000000;
+}
+
 word SegaController32U4::getFinalState() {
 #ifdef DEBUG
   if ((_previousState == SC_BTN_HOME) && (_currentState == (SC_BTN_HOME | SC_BTN_C))) {
@@ -210,6 +229,9 @@ word SegaController32U4::getFinalState() {
 
   _previousState = _currentState;
 
+  _sixButtonPad = _sixButtonRead;
+  _sixButtonRead = false;
+
   word return_value = _currentState;
 
   // In Mister mode, instead of sending the custom home button, send MODE +
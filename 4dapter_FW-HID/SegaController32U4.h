@@ -69,6 +69,7 @@ enum
 };
 
 const byte SC_CYCLE_DELAY = 10; // Delay (µs) between setting the select pin and reading the button pins
+const word SC_RESET_DELAY = 1600; // Idle time (µs) needed by 6-button controllers to reset their cycle counter
 
 class SegaController32U4 
 {
@@ -78,6 +79,23 @@ class SegaController32U4
     word updateState(void);
     word getFinalState(void);
 
+    // A Mega Drive pad answered the last read (SMS/Atari pads don't)
+    boolean connected(void) { return _connected; }
+
+    // The last read found a 6-button pad, only those need SC_RESET_DELAY
+    // between reads. 3-button and SMS/Atari pads can be read back to back.
+    boolean sixButton(void) { return _sixButtonPad; }
+
+    // Any of the lines held low between reads (select high): a button on an
+    // SMS/Atari pad, or up/down/left/right/B/C on a Mega Drive pad. Only
+    // reads the pins, so it can be checked every pass.
+    boolean inputActive(void);
+
+    // updateState() in two halves, so the SC_CYCLE_DELAY settle time can be
+    // spent elsewhere. readState() must not follow before that time is up.
+    void toggleSelect(void);
+    word readState(void);
+
   private:
     // Should A and B and X and Y be swapped?
     void toggleMisterMode(void);
@@ -97,6 +115,8 @@ class SegaController32U4
 
     boolean _connected;
     boolean _sixButtonMode;
+    boolean _sixButtonRead; // X/Y/Z/Mode came in during the current read
+    boolean _sixButtonPad;  // and in the last complete one
 
     byte _inputReg1;
     byte _inputReg2;
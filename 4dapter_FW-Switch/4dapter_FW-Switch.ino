@@ -4,67 +4,16 @@
 #include "Joystick.h"
 #include "SegaController32U4.h"
 #include "N64_Controller.h"
+#include "N64Stick.h"
+#include "NESSNES_Scanner.h"
+#include "PortPresence.h"
+#include "PressLatch.h"
+#include "BusSampler.h"
+#include "PadTables.h"
 
-uint32_t buttonStatus[18];
-
-#define DPAD_UP_MASK_ON         0x00
-#define DPAD_UPRIGHT_MASK_ON    0x01
-#define DPAD_RIGHT_MASK_ON      0x02
-#define DPAD_DOWNRIGHT_MASK_ON  0x03
-#define DPAD_DOWN_MASK_ON       0x04
-#define DPAD_DOWNLEFT_MASK_ON   0x05
-#define DPAD_LEFT_MASK_ON       0x06
-#define DPAD_UPLEFT_MASK_ON     0x07
-#define DPAD_NOTHING_MASK_ON    0x08
-
-#define Y_MASK_ON         0x01
-#define B_MASK_ON         0x02
-#define A_MASK_ON         0x04
-#define X_MASK_ON         0x08
-#define LB_MASK_ON        0x10
-#define RB_MASK_ON        0x20
-#define ZL_MASK_ON        0x40
-#define ZR_MASK_ON        0x80
-#define SELECT_MASK_ON    0x100
-#define START_MASK_ON     0x200
-#define L3_MASK_ON        0x400
-#define R3_MASK_ON        0x800
-#define HOME_MASK_ON      0x1000
-#define CAPTURE_MASK_ON   0x2000
-
-#define BUTTONUP      0
-#define BUTTONDOWN    1
-#define BUTTONLEFT    2
-#define BUTTONRIGHT   3
-#define BUTTONA       4
-#define BUTTONB       5
-#define BUTTONX       6
-#define BUTTONY       7
-#define BUTTONLB      8
-#define BUTTONRB      9
-#define BUTTONLT      10
-#define BUTTONRT      11
-#define BUTTONSTART   12
-#define BUTTONSELECT  13
-#define BUTTONHOME    14
-#define BUTTONCAPTURE 15
-#define BUTTONL3      16
-#define BUTTONR3      17
-
-#define NES       0
-#define SNES      1
-#define GENESIS   2
-
-#define BUTTONS   0
-#define AXES      1
-
-#define UP        0x01
-#define DOWN      0x02
-#define LEFT      0x04
-#define RIGHT     0x08
+uint32_t virtualPad = 0;  // PAD(BUTTON*) bits, see buttonRead()
 
-#define NTT_BIT   0x00
-#define NODATA    0x00
+#define GENESIS   2
 
 long LeftX = 0;
 long LeftY = 0;
@@ -76,94 +25,52 @@ bool Swap_N64_Button = false;
 bool Swap_Gen_Button = false;
 #define toggleDelay 1500
 
-//Set N64 Joystick Maximum Travel Range (0-127, typically between 75-85 on OEM controllers)
+//Set N64 Joystick Maximum Travel Range until learned (0-127, typically between 75-85 on OEM controllers)
 #define N64JoyMax 80
 
-void sendLatch();
-void sendClock();
+//GameCube analog trigger travel (0-255) that presses ZL / ZR
+#define GC_TRIGGER_PRESS 64
+
 void sendState();
 void processInputs();
 
 // Manage EEPROM by making sure everything has
 // its own index.
-enum EEPROMIndices { GENESIS_EEPROM };
+// N64_STICK_EEPROM takes N64_STICK_EEPROM_SIZE bytes.
+enum EEPROMIndices { GENESIS_EEPROM, N64_STICK_EEPROM };
 
 // Set up USB HID gamepads
 SegaController32U4  gen_controller(GENESIS_EEPROM);
 N64Controller       n64_controller;
 N64_status_packet   N64Data;
 
+// N64 stick conversion and travel calibration, see N64Stick.h
+N64Stick n64Stick(N64_STICK_EEPROM, N64_STICK_UNSIGNED, true, N64JoyMax, 0, true);
+
 // Controllers
-uint32_t  controllerData[2][2]  = {{0,0},{0,0}};
-uint32_t  axisIndicator[32]     = {0,0,0,0,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-uint16_t  currentGenesisState   = 0;
-bool      nttActive             = false;
-
-uint32_t  dataMaskNES[8] =        {0x02,   // A
-                                   0x01,   // B
-                                   0x40,   // Start 
-                                   0x80,   // Select
-                                   UP,     // D-Up
-                                   DOWN,   // D-Down
-                                   LEFT,   // D-Left
-                                   RIGHT   // D-Right
-                                   }; 
-
-// Power Pad D4
-uint32_t  dataMaskPowerPadD4[8] = {0x08,    // PowerPad #4
-                                   0x04,    // PowerPad #3
-                                   0x800,   // PowerPad #12
-                                   0x80,    // PowerPad #8
-                                   NODATA,  // No Data
-                                   NODATA,  // No Data
-                                   NODATA,  // No Data
-                                   NODATA   // No Data
-                                   }; 
-
-// Power Pad D3
-uint32_t  dataMaskPowerPadD3[8] = {0x02,   // PowerPad #2
-                                   0x01,   // PowerPad #1
-                                   0x10,   // PowerPad #5
-                                   0x100,  // PowerPad #9
-                                   0x20,   // PowerPad #6
-                                   0x200,  // PowerPad #10
-                                   0x400,  // PowerPad #11
-                                   0x40    // PowerPad #7
-                                   }; 
-
-uint32_t  dataMaskSNES[32] =      {0x01,    // B
-                                   0x04,    // Y
-                                   0x40,    // Start   
-                                   0x80,    // Select
-                                   UP,      // D-Up
-                                   DOWN,    // D-Down
-                                   LEFT,    // D-Left
-                                   RIGHT,   // D-Right
-                                   0x02,    // A
-                                   0x08,    // X
-                                   0x10,    // L
-                                   0x20,    // R
-                                   NODATA,  // SNES Control Bit
-                                   NTT_BIT, // NTT Indicator Bit
-                                   NODATA,  // SNES Control Bit
-                                   NODATA,  // SNES Control Bit
-                                   0x100,   // NTT 0
-                                   0x200,   // NTT 1
-                                   0x400,   // NTT 2
-                                   0x800,   // NTT 3
-                                   0x1000,  // NTT 4
-                                   0x2000,  // NTT 5
-                                   0x4000,  // NTT 6
-                                   0x8000,  // NTT 7
-                                   0x10000, // NTT 8
-                                   0x20000, // NTT 9
-                                   0x40000, // NTT *
-                                   0x80000, // NTT #
-                                   0x100000,// NTT .
-                                   0x200000,// NTT C
-                                   NODATA,  // NTT No Data
-                                   0x800000,// NTT End Comms
-                                   };
+NESSNESScanner scanner;
+uint32_t  busData[2][2]         = {{0,0},{0,0}};  // As scanned
+uint32_t  controllerData[2][2]  = {{0,0},{0,0}};  // As reported
+uint16_t  genesisData           = 0;              // As scanned
+uint16_t  currentGenesisState   = 0;              // As reported
+uint32_t  n64Data               = 0;              // As scanned, N64Data.data1 | data2 << 8 | gcButtons << 16
+uint8_t   gcButtons             = 0;              // GameCube X / Y (GC_BTN_*)
+
+// Empty ports are only probed every PRESENCE_PROBE_MS
+PortPresence genesisPort;
+PortPresence busPort;     // NES/SNES/Power Pad, one shared latch and clock
+PortPresence n64Port;
+
+#if (PRESS_LATCH == true)
+// Presses held until the host collected a report with them, see PressLatch.h.
+// The loop scans several times per report interval, taps in between are kept.
+PressLatch busLatch[2][2];  // busData
+PressLatch genesisLatch;
+PressLatch n64Latch;        // n64Data
+#define LATCH(latch, pressed)  (latch).sample(pressed)
+#else
+#define LATCH(latch, pressed)  (pressed)
+#endif
 
 void setup() 
 {
@@ -198,247 +105,191 @@ void setup()
   PORTB |= B00000100; // high
   
   SetupHardware();
+#if (BUS_SAMPLER == true)
+  busSampler.begin();
+#endif
   GlobalInterruptEnable();
 }
 
 void loop() 
 {   
-    currentGenesisState = 0;
+    genesisData = 0;
+    unsigned long now = millis();
     
-    //8 cycles needed to capture 6-button controllers
-    for(uint8_t i = 0; i < 8; i++)
+#if (BUS_SAMPLER == true)
+    // Scanned by the Timer3 interrupt
+    bool busDue = false;
+    bool busProbe = false;
+#else
+    // The probe runs past the shift registers, every PRESENCE_PROBE_MS also
+    // with pads present to notice them being unplugged
+    bool busDue = busPort.due(now);
+    bool busProbe = busPort.probeDue(now);
+#endif
+
+    //8 cycles needed to capture 6-button controllers, the select line settle
+    //time of each one is spent clocking the NES/SNES bus. An empty port is
+    //left alone until it is probed again or a line goes low (SMS/Atari pads
+    //can't be told from an empty port until pressed).
+    if(busDue)
+      scanner.begin(busProbe);
+
+    if(genesisPort.due(now) || gen_controller.inputActive())
     {
-      currentGenesisState = gen_controller.updateState();
+      for(uint8_t i = 0; i < 8; i++)
+      {
+        gen_controller.toggleSelect();
+
+        if(busDue)
+          scanner.stepFor(SC_CYCLE_DELAY);
+        else
+          delayMicroseconds(SC_CYCLE_DELAY);
+
+        genesisData = gen_controller.readState();
+      }
+
+      genesisData = gen_controller.getFinalState();
+      genesisPort.update(gen_controller.connected() || genesisData != 0, now);
     }
 
-    currentGenesisState = gen_controller.getFinalState();
-    
-    for(uint8_t j = 0; j < 1; j++)
+    if(busDue)
     {
-      sendLatch();
-
-      controllerData[NES][BUTTONS] = 0;
-      controllerData[NES][AXES] = 0;
-      
-      controllerData[SNES][BUTTONS] = 0;
-      controllerData[SNES][AXES] = 0;
+      while(scanner.step());
+      scanner.finish(busData);
 
-      nttActive = false;
-  
-      for(uint8_t dataBitCounter = 0; dataBitCounter < 32; dataBitCounter++)
+      if(busProbe)
       {
-        // If no NTT controller, end the loop early
-        if(!nttActive && dataBitCounter > 13)
-        {
-          break;
-        }
-
-        //NES Power Pad Controller
-        if((dataBitCounter < 8) && ((PINB & B00100000) == 0)) //Power Pad Pin D4 (bottom)
-        { 
-          controllerData[NES][BUTTONS] |= dataMaskPowerPadD4[dataBitCounter];
-        }
-
-        if((dataBitCounter < 8) && ((PINB & B00010000) == 0)) //Power Pad Pin D3 (middle)
-        { 
-          controllerData[NES][BUTTONS] |= dataMaskPowerPadD3[dataBitCounter];
-        }
-
-        // NES Controller
-        if((dataBitCounter < 8) && ((PINF & B10000000) == 0)) //If NES data line is low (indicating a press)
-        { 
-          if(axisIndicator[dataBitCounter])
-          {
-            controllerData[NES][AXES] |= dataMaskNES[dataBitCounter];
-          }
-          else
-          {
-            controllerData[NES][BUTTONS] |= dataMaskNES[dataBitCounter];
-          }
-        }
-
-        // SNES / NTT Controller 
-        if((PINF & B01000000) == 0) //If SNES data line is low (indicating a press)
-        {
-          if(dataBitCounter == 13)
-          {
-            nttActive = true;
-          }
-          
-          if(axisIndicator[dataBitCounter])
-          {
-            controllerData[SNES][AXES] |= dataMaskSNES[dataBitCounter];
-          }
-          else
-          {
-            controllerData[SNES][BUTTONS] |= dataMaskSNES[dataBitCounter];
-          }
-        }
-        
-        sendClock();
+        busPort.update(scanner.padsPresent, now);
+
+        // Pads plugged in or out, find the latch/clock timing they all keep up with
+        if(scanner.padsChanged)
+          scanner.calibrate();
       }
     }
+#if (BUS_SAMPLER == true)
+    busSampler.read(busData);
+#endif
 
-  __builtin_avr_delay_cycles(1000);
-
-  n64_controller.getN64Packet();
+  if(n64Port.due(now))
+  {
+    n64_controller.getN64Packet();
+    n64Port.update(n64_controller.controllerType != JOYBUS_NONE, now);
+  }
   N64Data = n64_controller.N64_status;
+
+  // GameCube pad: Z is R like on the Switch GameCube adapter, L / R are the
+  // triggers, set in buttonRead() with the C-stick and X / Y
+  gcButtons = 0;
+  if (n64_controller.controllerType == JOYBUS_GAMECUBE)
+  {
+    N64Data.data2  = (N64Data.data1 & 0x20) ? 0x10 : 0; // Z as R, drops L / R / C
+    N64Data.data1 &= ~0x20;
+    gcButtons = n64_controller.GC_status.buttons1 & (GC_BTN_X | GC_BTN_Y);
+  }
+
+  n64Data = N64Data.data1 | (N64Data.data2 << 8) | ((uint32_t)gcButtons << 16);
   
   sendState();
 }
 
-void sendState()
+// Reported state from the newest scans, with the latched presses
+void latchInputs()
 {
-  buttonRead();
-  processInputs();
-  HID_Task();
-  USB_USBTask();
-}
+  currentGenesisState = LATCH(genesisLatch, genesisData);
 
-void sendLatch()
-{
-  // Send a latch pulse to NES/SNES
-  PORTD |=  B00000010; // Set HIGH
-  __builtin_avr_delay_cycles(192);
-  PORTD &= ~B00000010; // Set LOW
-  __builtin_avr_delay_cycles(72);
-}
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    controllerData[i][BUTTONS] = LATCH(busLatch[i][BUTTONS], busData[i][BUTTONS]);
+    controllerData[i][AXES]    = LATCH(busLatch[i][AXES], busData[i][AXES]);
+  }
 
-void sendClock()
-{
-  // Send a clock pulse to NES/SNES
-  PORTD |=  B00000001; // Set HIGH
-  __builtin_avr_delay_cycles(96);
-  PORTD &= ~B00000001; // Set LOW
-  __builtin_avr_delay_cycles(72);
+  uint32_t n64State = LATCH(n64Latch, n64Data);
+  N64Data.data1 = n64State;
+  N64Data.data2 = n64State >> 8;
+  gcButtons     = n64State >> 16;
 }
 
-void buttonRead()
+void sendState()
 {
-  buttonStatus[BUTTONUP]      = (controllerData[NES][AXES] & UP)          |  (controllerData[SNES][AXES] & UP)          | ((currentGenesisState & SC_BTN_UP) >> SC_BIT_SH_UP) | (N64Data.data1 & 0x08 ? 1:0);
-  buttonStatus[BUTTONDOWN]    = ((controllerData[NES][AXES] & DOWN) >> 1)  | ((controllerData[SNES][AXES] & DOWN) >> 1)  | ((currentGenesisState & SC_BTN_DOWN) >> SC_BIT_SH_DOWN) | (N64Data.data1 & 0x04 ? 1:0);
-  buttonStatus[BUTTONLEFT]    = ((controllerData[NES][AXES] & LEFT) >> 2)  | ((controllerData[SNES][AXES] & LEFT) >> 2)  | ((currentGenesisState & SC_BTN_LEFT) >> SC_BIT_SH_LEFT) | (N64Data.data1 & 0x02 ? 1:0);
-  buttonStatus[BUTTONRIGHT]   = ((controllerData[NES][AXES] & RIGHT) >> 3) | ((controllerData[SNES][AXES] & RIGHT) >> 3) | ((currentGenesisState & SC_BTN_RIGHT) >> SC_BIT_SH_RIGHT) | (N64Data.data1 & 0x01 ? 1:0);
-  buttonStatus[BUTTONA]       = (controllerData[NES][BUTTONS] & 0x02 ? 1:0) | (controllerData[SNES][BUTTONS] & 0x02 ? 1:0) | (currentGenesisState & SC_BTN_C ? 1:0) | (N64Data.data1 & 0x80 ? 1:0);
-  
-  if(Swap_N64_Button)
-  {
-    buttonStatus[BUTTONRB]      = (controllerData[SNES][BUTTONS] & 0x20) | (currentGenesisState & SC_BTN_Z ? 1:0) | (N64Data.data2 & 0x10 ? 1:0);  
-    buttonStatus[BUTTONB]       = (controllerData[NES][BUTTONS] & 0x01 ? 1:0) | (controllerData[SNES][BUTTONS] & 0x01 ? 1:0) | (currentGenesisState & SC_BTN_B ? 1:0);
-    buttonStatus[BUTTONX]       = (controllerData[SNES][BUTTONS] & 0x08) | (currentGenesisState & SC_BTN_Y ? 1:0) | (N64Data.data1 & 0x40 ? 1:0);
-  }
-  else if(Swap_Gen_Button)
-  {
-    buttonStatus[BUTTONRB]      = (controllerData[SNES][BUTTONS] & 0x20) | (currentGenesisState & SC_BTN_Y ? 1:0) | (N64Data.data2 & 0x10 ? 1:0);
-    buttonStatus[BUTTONB]       = (controllerData[NES][BUTTONS] & 0x01 ? 1:0) | (controllerData[SNES][BUTTONS] & 0x01 ? 1:0) | (currentGenesisState & SC_BTN_B ? 1:0) | (N64Data.data1 & 0x40 ? 1:0);
-    buttonStatus[BUTTONX]       = (controllerData[SNES][BUTTONS] & 0x08) | (currentGenesisState & SC_BTN_Z ? 1:0);
-  }
-  else
+  // The report is only assembled once the Switch collected the previous one,
+  // from the newest scans, and goes straight into the free endpoint bank.
+  // The passes in between just latch the presses.
+  bool taken = HID_ReportTaken();
+
+#if (PRESS_LATCH == true)
+  if(taken)
   {
-    buttonStatus[BUTTONRB]      = (controllerData[SNES][BUTTONS] & 0x20) | (currentGenesisState & SC_BTN_Z ? 1:0) | (N64Data.data2 & 0x10 ? 1:0);
-    buttonStatus[BUTTONB]       = (controllerData[NES][BUTTONS] & 0x01 ? 1:0) | (controllerData[SNES][BUTTONS] & 0x01 ? 1:0) | (currentGenesisState & SC_BTN_B ? 1:0) | (N64Data.data1 & 0x40 ? 1:0);
-    buttonStatus[BUTTONX]       = (controllerData[SNES][BUTTONS] & 0x08) | (currentGenesisState & SC_BTN_Y ? 1:0);
+    for(uint8_t i = 0; i < 2; i++)
+    {
+      busLatch[i][BUTTONS].delivered();
+      busLatch[i][AXES].delivered();
+    }
+    genesisLatch.delivered();
+    n64Latch.delivered();
   }
-  
-  buttonStatus[BUTTONY]       = (controllerData[SNES][BUTTONS] & 0x04) | (currentGenesisState & SC_BTN_A ? 1:0);
-  buttonStatus[BUTTONLB]      = (controllerData[SNES][BUTTONS] & 0x10) | (currentGenesisState & SC_BTN_X ? 1:0) | (N64Data.data2 & 0x20 ? 1:0);
-  buttonStatus[BUTTONLT]      = (N64Data.data1 & 0x20 ? 1:0);
-  buttonStatus[BUTTONRT]      = 0;
-  buttonStatus[BUTTONSTART]   = (controllerData[NES][BUTTONS] & 0x80) | (controllerData[SNES][BUTTONS] & 0x80) | (currentGenesisState & SC_BTN_START ? 1:0) | (N64Data.data1 & 0x10 ? 1:0);
-  buttonStatus[BUTTONSELECT]  = (controllerData[NES][BUTTONS] & 0x40) | (controllerData[SNES][BUTTONS] & 0x40) | (currentGenesisState & SC_BTN_MODE ? 1:0);
-  buttonStatus[BUTTONHOME]    = (currentGenesisState & SC_BTN_HOME ? 1:0);
-  buttonStatus[BUTTONCAPTURE] = 0;
-  buttonStatus[BUTTONL3]      = 0;
-  buttonStatus[BUTTONR3]      = 0;
+#endif
 
-  //////////////////////////////////////////////
-
-  toggleControls();
+  latchInputs();
 
-  //////////////////////////////////////////////
-
-  // N64: In-Game Menu Command (D-Down + Start)
-  if((N64Data.data1 & 0x04 ? 1:0) && (N64Data.data1 & 0x10 ? 1:0)) 
+  if(taken)
   {
-    buttonStatus[BUTTONDOWN]    = 0;
-    buttonStatus[BUTTONSTART]   = 0;
-    buttonStatus[BUTTONSELECT]  = 1;
+    buttonRead();
+    processInputs();
   }
 
-  // N64: Screenshot Command (D-Up + Start)
-  if((N64Data.data1 & 0x08 ? 1:0) && (N64Data.data1 & 0x10 ? 1:0)) 
+#if (PRESS_LATCH == true)
+  if(HID_Task(taken))
   {
-    buttonStatus[BUTTONUP]      = 0;
-    buttonStatus[BUTTONSTART]   = 0;
-    buttonStatus[BUTTONCAPTURE] = 1;
-  }
-  
-  // N64: Home Command (L + R + Start, trigger 'reset' flag on OEM controllers)
-  if((N64Data.data2 & 0x80 ? 1:0) || ( (N64Data.data2 & 0x20 ? 1:0) && (N64Data.data2 & 0x10 ? 1:0) && (N64Data.data1 & 0x10 ? 1:0) ))
-  {
-    buttonStatus[BUTTONLB]      = 0;
-    buttonStatus[BUTTONRB]      = 0;
-    buttonStatus[BUTTONSTART]   = 0;
-    buttonStatus[BUTTONHOME]    = 1;
+    for(uint8_t i = 0; i < 2; i++)
+    {
+      busLatch[i][BUTTONS].sent();
+      busLatch[i][AXES].sent();
+    }
+    genesisLatch.sent();
+    n64Latch.sent();
   }
+#else
+  HID_Task(taken);
+#endif
+#if !defined(INTERRUPT_CONTROL_ENDPOINT)
+  USB_USBTask();
+#endif
+}
 
-  /////////////////////////////////////////////
+void buttonRead()
+{
+  const PadMap *genesisMap = GENESIS_MAP;
+  const PadMap *n64Map     = N64_MAP;
 
-  // NES - SNES - Genesis: Home Command (Select/Mode + Start)
-  if(buttonStatus[BUTTONSELECT] && buttonStatus[BUTTONSTART])  
-  {
-    buttonStatus[BUTTONSTART]   = 0;
-    buttonStatus[BUTTONSELECT]  = 0;
-    buttonStatus[BUTTONHOME]    = 1;
-  }
+  if(Swap_N64_Button)
+    n64Map = N64_MAP_SWAPPED;
+  else if(Swap_Gen_Button)
+    genesisMap = GENESIS_MAP_SWAPPED;
 
-  // NES - SNES - Genesis: In-Game Menu Command (Select/Mode + D-Down)
-  if(buttonStatus[BUTTONSELECT] && buttonStatus[BUTTONDOWN])
-  {
-    buttonStatus[BUTTONSELECT]  = 0;
-    buttonStatus[BUTTONDOWN]    = 0;
-    buttonStatus[BUTTONLT]      = 1;
-    buttonStatus[BUTTONRT]      = 1;
-  }
+  uint32_t n64State = N64Data.data1 | (N64Data.data2 << 8) | ((uint32_t)gcButtons << 16);
 
-  // NES - SNES - Genesis: Screenshot Command (Select/Mode + D-Up)
-  if(buttonStatus[BUTTONSELECT] && buttonStatus[BUTTONUP])  
+  uint32_t pad = padMap(controllerData[NES][AXES] | controllerData[SNES][AXES], DPAD_MAP, PAD_ENTRIES(DPAD_MAP))
+               | padMap(controllerData[NES][BUTTONS], NES_MAP, PAD_ENTRIES(NES_MAP))
+               | padMap(controllerData[SNES][BUTTONS], SNES_MAP, PAD_ENTRIES(SNES_MAP))
+               | padMap(currentGenesisState, genesisMap, PAD_ENTRIES(GENESIS_MAP))
+               | padMap(n64State, n64Map, PAD_ENTRIES(N64_MAP));
+
+  if (n64_controller.controllerType == JOYBUS_GAMECUBE)
   {
-    buttonStatus[BUTTONUP]      = 0;
-    buttonStatus[BUTTONSELECT]  = 0;
-    buttonStatus[BUTTONCAPTURE] = 1;
+    GC_status_packet &gc = n64_controller.GC_status;
+    if(gc.trigger_l >= GC_TRIGGER_PRESS) pad |= PAD(BUTTONLT);
+    if(gc.trigger_r >= GC_TRIGGER_PRESS) pad |= PAD(BUTTONRT);
   }
 
-  /////////////////////////////////////////////
+  //////////////////////////////////////////////
 
-  // Genesis 3-Button: In-Game Menu Command (A + B + C + Start)
-  if((!gen_controller.sixButtonMode) && (currentGenesisState & SC_BTN_START ? 1:0) && (currentGenesisState & SC_BTN_A ? 1:0) && (currentGenesisState & SC_BTN_B ? 1:0) && (currentGenesisState & SC_BTN_C ? 1:0))
-  {
-    buttonStatus[BUTTONSTART] = 0;
-    buttonStatus[BUTTONY]     = 0;
-    buttonStatus[BUTTONB]     = 0;
-    buttonStatus[BUTTONA]     = 0;
-    buttonStatus[BUTTONLT]    = 1;
-    buttonStatus[BUTTONRT]    = 1;
-  }
+  toggleControls(pad, n64State);
 
-  // Genesis 3-Button: Home Command (A + D-Down + Start)
-  if((!gen_controller.sixButtonMode) && (currentGenesisState & SC_BTN_START ? 1:0) && (currentGenesisState & SC_BTN_A ? 1:0) && ((currentGenesisState & SC_BTN_DOWN) >> SC_BIT_SH_DOWN))
-  {
-    buttonStatus[BUTTONSTART] = 0;
-    buttonStatus[BUTTONY]     = 0;
-    buttonStatus[BUTTONDOWN]  = 0;
-    buttonStatus[BUTTONHOME]  = 1;
-  } 
-
-  // Genesis 3-Button: Home Command (A + D-Up + Start)
-  if((!gen_controller.sixButtonMode) && (currentGenesisState & SC_BTN_START ? 1:0) && (currentGenesisState & SC_BTN_A ? 1:0) && ((currentGenesisState & SC_BTN_UP) >> SC_BIT_SH_UP))
-  {
-    buttonStatus[BUTTONSTART]   = 0;
-    buttonStatus[BUTTONY]       = 0;
-    buttonStatus[BUTTONUP]      = 0;
-    buttonStatus[BUTTONCAPTURE] = 1;
-  }
+  //////////////////////////////////////////////
+
+  uint32_t genesis3        = gen_controller.sixButtonMode ? 0 : currentGenesisState;
+  uint32_t hotkeySources[] = {0, n64State, genesis3};
+  virtualPad = padHotkeys(pad, hotkeySources, HOTKEYS, PAD_ENTRIES(HOTKEYS));
 
   ///////////////////////////////////////////
 
@@ -452,20 +303,26 @@ void buttonRead()
 
   //////////////////////////////////////////
 
-  if(N64Data.stick_x > N64JoyMax)   N64Data.stick_x = N64JoyMax;
-  if(N64Data.stick_x < -N64JoyMax)  N64Data.stick_x = -N64JoyMax;
-  if(N64Data.stick_y > N64JoyMax)   N64Data.stick_y = N64JoyMax;
-  if(N64Data.stick_y < -N64JoyMax)  N64Data.stick_y = -N64JoyMax;
+  if (n64_controller.controllerType == JOYBUS_GAMECUBE)
+  {
+    // Full range sticks, the N64 stick calibration doesn't apply
+    LeftX  = n64_controller.GC_status.stick_x;
+    LeftY  = 255 - n64_controller.GC_status.stick_y;
+    RightX = n64_controller.GC_status.cstick_x;
+    RightY = 255 - n64_controller.GC_status.cstick_y;
+    return;
+  }
 
-  LeftX = map(N64Data.stick_x, -N64JoyMax, N64JoyMax, 0, 255);
-  LeftY = map(-N64Data.stick_y, -N64JoyMax, N64JoyMax, 0, 255);
+  n64Stick.update(N64Data);
+  LeftX = n64Stick.x(N64Data.stick_x);
+  LeftY = n64Stick.y(N64Data.stick_y);
 }
 
-void toggleControls()
+void toggleControls(uint32_t pad, uint32_t n64State)
 { 
   static unsigned long currentTime = 0;
   
-  if(buttonStatus[BUTTONSELECT] && buttonStatus[BUTTONDOWN])
+  if(padHeld(pad, PAD(BUTTONSELECT) | PAD(BUTTONDOWN)))
   {
      if(millis() - currentTime > toggleDelay)
      {
@@ -484,7 +341,7 @@ void toggleControls()
        currentTime = millis();     
      }
   }
-  else if(buttonStatus[BUTTONSELECT] && buttonStatus[BUTTONB])
+  else if(padHeld(pad, PAD(BUTTONSELECT) | PAD(BUTTONB)))
   {
      if(millis() - currentTime > toggleDelay)
      {
@@ -504,7 +361,7 @@ void toggleControls()
      }
   }
 
-  else if((N64Data.data1 & 0x10 ? 1:0) && (N64Data.data1 & 0x04 ? 1:0))
+  else if(padHeld(n64State, N64_START | N64_DOWN))
   {
      if(millis() - currentTime > toggleDelay)
      {
@@ -532,53 +389,25 @@ void toggleControls()
 
 void processInputs()
 {
+  uint8_t hat = pgm_read_byte(&DPAD_HAT[virtualPad & PAD_DPAD]);
+
   //D-Pad as Left Joystick
   if(Swap_DPAD_JOY == true)
   { 
-    if      ((buttonStatus[BUTTONUP]) && (buttonStatus[BUTTONRIGHT]))     {ReportData.LX = 255; ReportData.LY = 000;}
-    else if ((buttonStatus[BUTTONDOWN]) && (buttonStatus[BUTTONRIGHT]))   {ReportData.LX = 255; ReportData.LY = 255;} 
-    else if ((buttonStatus[BUTTONDOWN]) && (buttonStatus[BUTTONLEFT]))    {ReportData.LX = 000; ReportData.LY = 255;}
-    else if ((buttonStatus[BUTTONUP]) && (buttonStatus[BUTTONLEFT]))      {ReportData.LX = 000; ReportData.LY = 000;}
-    else if (buttonStatus[BUTTONUP])                                      {ReportData.LX = 128; ReportData.LY = 000;}
-    else if (buttonStatus[BUTTONDOWN])                                    {ReportData.LX = 128; ReportData.LY = 255;}
-    else if (buttonStatus[BUTTONLEFT])                                    {ReportData.LX = 000; ReportData.LY = 128;}
-    else if (buttonStatus[BUTTONRIGHT])                                   {ReportData.LX = 255; ReportData.LY = 128;}
-    else                                                                  {ReportData.LX = 128; ReportData.LY = 128;}
-    
+    ReportData.LX  = pgm_read_byte(&HAT_STICK_X[hat]);
+    ReportData.LY  = pgm_read_byte(&HAT_STICK_Y[hat]);
     ReportData.HAT = DPAD_NOTHING_MASK_ON;
   }
   //D-Pad as Direction Pad (HAT)
   else
   {
-    ReportData.LX = (N64Data.stick_x == 0 ? 128 : LeftX);
-    ReportData.LY = (N64Data.stick_y == 0 ? 128 : LeftY);
-    
-    if      ((buttonStatus[BUTTONUP]) && (buttonStatus[BUTTONRIGHT]))     {ReportData.HAT = DPAD_UPRIGHT_MASK_ON;}
-    else if ((buttonStatus[BUTTONDOWN]) && (buttonStatus[BUTTONRIGHT]))   {ReportData.HAT = DPAD_DOWNRIGHT_MASK_ON;} 
-    else if ((buttonStatus[BUTTONDOWN]) && (buttonStatus[BUTTONLEFT]))    {ReportData.HAT = DPAD_DOWNLEFT_MASK_ON;}
-    else if ((buttonStatus[BUTTONUP]) && (buttonStatus[BUTTONLEFT]))      {ReportData.HAT = DPAD_UPLEFT_MASK_ON;}
-    else if (buttonStatus[BUTTONUP])                                      {ReportData.HAT = DPAD_UP_MASK_ON;}
-    else if (buttonStatus[BUTTONDOWN])                                    {ReportData.HAT = DPAD_DOWN_MASK_ON;}
-    else if (buttonStatus[BUTTONLEFT])                                    {ReportData.HAT = DPAD_LEFT_MASK_ON;}
-    else if (buttonStatus[BUTTONRIGHT])                                   {ReportData.HAT = DPAD_RIGHT_MASK_ON;}
-    else                                                                  {ReportData.HAT = DPAD_NOTHING_MASK_ON;}
+    ReportData.LX  = (N64Data.stick_x == 0 ? 128 : LeftX);
+    ReportData.LY  = (N64Data.stick_y == 0 ? 128 : LeftY);
+    ReportData.HAT = hat;
   }
   
   ReportData.RX = RightX;
   ReportData.RY = RightY;
 
-  if (buttonStatus[BUTTONA])            {ReportData.Button |= A_MASK_ON;}
-  if (buttonStatus[BUTTONB])            {ReportData.Button |= B_MASK_ON;}
-  if (buttonStatus[BUTTONX])            {ReportData.Button |= X_MASK_ON;}
-  if (buttonStatus[BUTTONY])            {ReportData.Button |= Y_MASK_ON;}
-  if (buttonStatus[BUTTONLB])           {ReportData.Button |= LB_MASK_ON;}
-  if (buttonStatus[BUTTONRB])           {ReportData.Button |= RB_MASK_ON;}
-  if (buttonStatus[BUTTONLT])           {ReportData.Button |= ZL_MASK_ON;}
-  if (buttonStatus[BUTTONRT])           {ReportData.Button |= ZR_MASK_ON;}
-  if (buttonStatus[BUTTONSTART])        {ReportData.Button |= START_MASK_ON;}
-  if (buttonStatus[BUTTONSELECT])       {ReportData.Button |= SELECT_MASK_ON;}
-  if (buttonStatus[BUTTONHOME])         {ReportData.Button |= HOME_MASK_ON;}
-  if (buttonStatus[BUTTONCAPTURE])      {ReportData.Button |= CAPTURE_MASK_ON;}
-  if (buttonStatus[BUTTONL3])           {ReportData.Button |= L3_MASK_ON;}
-  if (buttonStatus[BUTTONR3])           {ReportData.Button |= R3_MASK_ON;}
+  ReportData.Button |= padMap(virtualPad, SWITCH_MAP, PAD_ENTRIES(SWITCH_MAP));
 }
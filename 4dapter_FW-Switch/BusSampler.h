@@ -0,0 +1,73 @@
+/*  BusSampler.h
+ *
+ *  Scans the NES/SNES bus in the background. A Timer3 compare interrupt
+ *  drives the latch and clock lines one edge at a time and publishes every
+ *  finished scan to a double buffer, the main loop only picks up the newest
+ *  one. The bus is then read at a fixed rate, independent of the USB frames
+ *  and the other ports.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// 'true' to scan the NES/SNES bus from the Timer3 interrupt instead of the
+// loop. Takes over Timer3.
+#ifndef BUS_SAMPLER
+#define BUS_SAMPLER false
+#endif
+
+#if (BUS_SAMPLER == true)
+
+#include "NESSNES_Scanner.h"
+
+#define BUS_SAMPLE_US  500  // From one scan's latch to the next (max. 32000)
+#define BUS_EDGE_US    12   // Between two latch/clock edges, a scan takes 29 of them (65 with an NTT keypad)
+
+class BusSampler
+{
+  public:
+    BusSampler(void);
+
+    void begin(void);
+
+    // Copies the newest scan to data[NES|SNES][BUTTONS|AXES], true if
+    // there was a new one since the last call
+    bool read(uint32_t data[2][2]);
+
+    // Timer3 compare interrupt
+    void edge(void);
+
+  private:
+    NESSNESScanner _scanner;
+    bool _scanning;
+    uint16_t _scanStart;            // OCR3A of the scan's latch edge
+
+    // The interrupt finishes into the buffer the loop does not read. A scan
+    // takes far longer than read(), so _newest stays valid while it copies.
+    uint32_t _data[2][2][2];
+    volatile uint8_t _newest;
+    volatile uint8_t _published;    // Scans so far, wraps
+    uint8_t _read;                  // _published at the last read()
+};
+
+extern BusSampler busSampler;
+
+#endif
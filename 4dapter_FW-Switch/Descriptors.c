@@ -130,7 +130,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
       .EndpointAddress        = JOYSTICK_IN_EPADDR,
       .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
       .EndpointSize           = JOYSTICK_EPSIZE,
-      .PollingIntervalMS      = 0x04
+      .PollingIntervalMS      = JOYSTICK_IN_INTERVAL
     },
 
   .HID_ReportOUTEndpoint =
@@ -33,17 +33,28 @@ void EVENT_USB_Device_ConfigurationChanged(void) {
   // We can read ConfigSuccess to indicate a success or failure at this point.
 }
 
-// Process control requests sent to the device from the USB host.
+// Process control requests sent to the device from the USB host. With
+// INTERRUPT_CONTROL_ENDPOINT (LUFAConfig.h) the control request events run in
+// the USB interrupt, the scans in the main loop don't hold them up.
 void EVENT_USB_Device_ControlRequest(void) {
   // We can handle two control requests: a GetReport and a SetReport.
   // Not used here, it looks like we don't receive control request from the Switch.
 }
 
-// Process and deliver data from IN and OUT endpoints.
-void HID_Task(void) {
+// The IN endpoint has a single bank, it only becomes ready again once the host collected it.
+bool HID_ReportTaken(void) {
+  if (USB_DeviceState != DEVICE_STATE_Configured)
+    return false;
+
+  Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
+  return Endpoint_IsINReady();
+}
+
+// Process and deliver data from IN and OUT endpoints, ReportData only with 'send'.
+bool HID_Task(bool send) {
   // If the device isn't connected and properly configured, we can't do anything here.
   if (USB_DeviceState != DEVICE_STATE_Configured)
-    return;
+    return false;
 
   // We'll start with the OUT endpoint.
   Endpoint_SelectEndpoint(JOYSTICK_OUT_EPADDR);
@@ -67,7 +78,7 @@ void HID_Task(void) {
   // We'll then move on to the IN endpoint.
   Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
   // We first check to see if the host is ready to accept data.
-  if (Endpoint_IsINReady())
+  if (send && Endpoint_IsINReady())
   {
     // Once populated, we can output this data to the host. We do this by first writing the data to the control stream.
     Endpoint_Write_Stream_LE(&ReportData, sizeof(ReportData), NULL);
@@ -75,6 +86,9 @@ void HID_Task(void) {
     Endpoint_ClearIN();
     /* Clear the report data afterwards */
     memset(&ReportData, 0, sizeof(ReportData));
+    return true;
   }
+
+  return false;
 }
 
@@ -81,8 +81,11 @@ extern "C" {
 #endif
 // Setup all necessary hardware, including USB initialization.
 void SetupHardware(void);
-// Process and deliver data from IN and OUT endpoints.
-void HID_Task(void);
+// Process and deliver data from IN and OUT endpoints, ReportData only with
+// 'send'. True if ReportData went out.
+bool HID_Task(bool send);
+// The host collected the last report, HID_Task(true) sends ReportData.
+bool HID_ReportTaken(void);
 // USB device event handlers.
 void EVENT_USB_Device_Connect(void);
 void EVENT_USB_Device_Disconnect(void);
@@ -0,0 +1,101 @@
+/*  N64Stick.h
+ *
+ *  Converts the N64 analog stick: deadzone, clamp to the stick's travel,
+ *  optional response curve and scaling to the report format. Each of the
+ *  four directions keeps one fixed point scale factor, rebuilt only when
+ *  the calibration changes, so a conversion is one multiply instead of a
+ *  512 byte lookup table in RAM.
+ *
+ *  The travel of each of the four directions is learned while playing. It
+ *  grows once the stick went further than before on N64_STICK_GROW_READINGS
+ *  reads in a row, so a single glitched read can't widen it, and is saved to
+ *  EEPROM once the stick is back in the center. The save writes one byte per
+ *  update() and only when the EEPROM is ready, never waiting out a write.
+ *  Holding L + R + Start (the controller's own re-center combo) resets it to
+ *  N64_STICK_MIN_TRAVEL, then a few turns of the stick teach the travel of a
+ *  worn stick.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef N64Stick_h
+#define N64Stick_h
+
+#include <stdint.h>
+
+#include "N64_Controller.h"
+
+// 'true' for a response curve that is finer around the center,
+// (t + t^2) / 2 of the deflection instead of linear
+#ifndef N64_STICK_CURVE
+#define N64_STICK_CURVE false
+#endif
+
+#define N64_STICK_MIN_TRAVEL  50  // Travel after a reset, before the stick taught its own
+#define N64_STICK_EEPROM_SIZE 5   // Marker and the travel of +X, -X, +Y, -Y
+
+// Reads in a row past the travel before it grows
+#ifndef N64_STICK_GROW_READINGS
+#define N64_STICK_GROW_READINGS 3
+#endif
+
+enum
+{
+  N64_STICK_SIGNED = 0, // -128..127, center 0 (DInput)
+  N64_STICK_UNSIGNED    // 0..255, center 128 (XInput, Switch)
+};
+
+class N64Stick
+{
+  public:
+    // |eeprom_index| is the start of N64_STICK_EEPROM_SIZE bytes of EEPROM.
+    // |travel| is used until a calibration was saved, |scale| false passes
+    // the stick values through with only the deadzone applied.
+    N64Stick(int eeprom_index, uint8_t format, bool invertY, uint8_t travel, uint8_t deadzone, bool scale);
+
+    // Learns the travel from every status read and carries on a pending save
+    void update(const N64_status_packet &status);
+
+    uint8_t x(int8_t raw) const { return convert(0, raw); }
+    uint8_t y(int8_t raw) const { return convert(2, raw); }
+
+    uint8_t travel(uint8_t direction) const { return _travel[direction]; }
+
+  private:
+    uint8_t convert(uint8_t axis, int8_t raw) const;
+    void build(uint8_t direction);
+    void load(uint8_t travel);
+    void save();
+
+    const int _eeprom_index;
+    const uint8_t _format;
+    const bool _invertY;
+    const uint8_t _deadzone;
+    const bool _scale;
+
+    uint8_t _travel[4]; // +X, -X, +Y, -Y
+    uint8_t _beyond[4]; // Reads in a row past the travel
+    uint8_t _reach[4];  // Smallest of those reads
+    bool _dirty;
+    bool _resetHeld;
+    uint8_t _saveIndex; // Next EEPROM byte to save, N64_STICK_EEPROM_SIZE when done
+
+    uint32_t _factor[4]; // 127 / (travel - deadzone) as 16.16 fixed point
+};
+
+#endif
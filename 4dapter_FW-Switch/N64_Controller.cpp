@@ -13,7 +13,11 @@
 
 N64Controller::N64Controller()
 {
-  
+  memset(&N64_status, 0, sizeof(N64_status));
+  replyBits = 0;
+  controllerType = JOYBUS_NONE;
+  GC_originValid = false;
+  GC_rumble = false;
 }
 
 void N64Controller::N64_init()
@@ -23,43 +27,20 @@ void N64Controller::N64_init()
   pinMode(N64_PIN, INPUT);
 }
 
-void N64Controller::translate_N64_data()
-{
-    memset(&N64_status, 0, sizeof(N64_status));
-    
-    // line 1
-    // bits: A, B, Z, Start, Dup, Ddown, Dleft, Dright
-    // line 2
-    // bits: Reset, 0, L, R, Cup, Cdown, Cleft, Cright
-    // line 3
-    // bits: joystick x value
-    // These are 8 bit values centered at 0x80 (128)
-    // line 4
-    // bits: joystick 4 value
-    // These are 8 bit values centered at 0x80 (128)
-    
-    for (int i=0; i<8; i++) 
-    {
-        N64_status.data1 |= N64_raw_dump[i] ? (0x80 >> i) : 0;
-        N64_status.data2 |= N64_raw_dump[8+i] ? (0x80 >> i) : 0;
-        N64_status.stick_x |= N64_raw_dump[16+i] ? (0x80 >> i) : 0;
-        N64_status.stick_y |= N64_raw_dump[24+i] ? (0x80 >> i) : 0;
-    }
-}
-
-
 /**
- * This sends the given byte sequence to the controller
+ * This sends the given byte sequence to the controller and shifts the reply
+ * straight into 'reply', up to 'replyLength' bytes
  * length must be at least 1
  * Oh, it destroys the buffer passed in as it writes it
+ * Returns the number of reply bits received, a trailing partial byte is not
+ * stored
  */
-void N64Controller::N64_send_data_request(unsigned char *buffer, char length)
+uint8_t N64Controller::N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength)
 {
     char bits;
-    bool bit;
     unsigned char timeout;
-    char bitcount = 32;
-    char *bitbin = N64_raw_dump;
+    unsigned char data = 0;
+    uint8_t received = 0;
 
 
   outer_loop:
@@ -109,14 +90,14 @@ void N64Controller::N64_send_data_request(unsigned char *buffer, char length)
     N64_HIGH;
 
     //////////////////////
-    // listen for the expected 8 bytes of data back from the controller and
-    // blast it out to the N64_raw_dump array, one bit per byte for extra speed.
+    // listen for the reply, every bit is shifted into 'data' as it arrives
+    // and stored once its byte is complete
 
     timeout = 0x7f;
     while (!N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
 
 read_loop:
@@ -126,18 +107,21 @@ read_loop:
     while (N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
 
     //Wait 2us before reading data
     __builtin_avr_delay_cycles(32);
    
-    *bitbin = N64_QUERY;
-    ++bitbin;
-    --bitcount;
+    data = (data << 1) | (N64_QUERY ? 1 : 0);
+    ++received;
     
-    if (bitcount == 0)
-        return;
+    if ((received & 7) == 0)
+    {
+        *reply++ = data;
+        if (--replyLength == 0)
+            return received;
+    }
 
     // wait for line to go high again
     // it may already be high, so this should just drop through
@@ -145,7 +129,7 @@ read_loop:
     while (!N64_QUERY) 
     {
         if (!--timeout)
-            return;
+            return received;
     }
     
     goto read_loop;
@@ -153,9 +137,207 @@ read_loop:
 
 void N64Controller::getN64Packet()
 {
-    unsigned char N64Command[] = {0x01};
+    // reply bytes:
+    // 1: A, B, Z, Start, Dup, Ddown, Dleft, Dright
+    // 2: Reset, 0, L, R, Cup, Cdown, Cleft, Cright
+    // 3: joystick x value
+    // 4: joystick y value
+    // The joystick values are signed 8 bit, centered at 0
+    unsigned char reply[4];
+
+    // Unknown until a controller answers the identify command
+    if (controllerType == JOYBUS_NONE)
+    {
+        identify();
+
+        if (controllerType == JOYBUS_NONE)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            replyBits = 0;
+            return;
+        }
+    }
+
+    if (controllerType == JOYBUS_GAMECUBE)
+    {
+        getGCPacket();
+        return;
+    }
+
+    // A short or invalid reply (noisy cable, loose plug) is retried once,
+    // after that the last good state is kept. No reply at all means no
+    // controller, which releases everything.
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        unsigned char N64Command[] = {N64_GET_STATUS};
+        noInterrupts();
+        replyBits = N64_send_data_request(N64Command, 1, reply, sizeof(reply));
+        interrupts();
+
+        if (replyBits == 0)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            controllerType = JOYBUS_NONE;
+            return;
+        }
+
+        // bit 6 of the second byte is always 0
+        if (replyBits == 32 && !(reply[1] & 0x40))
+        {
+            N64_status.data1   = reply[0];
+            N64_status.data2   = reply[1];
+            N64_status.stick_x = reply[2];
+            N64_status.stick_y = reply[3];
+            return;
+        }
+    }
+}
+
+/**
+ * Asks the controller what it is. The second reply byte and the pak status
+ * in the third are not needed here.
+ */
+void N64Controller::identify()
+{
+    unsigned char command[] = {JOYBUS_IDENTIFY};
+    unsigned char reply[3];
+
     noInterrupts();
-    N64_send_data_request(N64Command, 1);
+    uint8_t bits = N64_send_data_request(command, 1, reply, sizeof(reply));
     interrupts();
-    translate_N64_data();
+
+    if (bits != 24)
+    {
+        controllerType = JOYBUS_NONE;
+    }
+    else if (reply[0] & JOYBUS_TYPE_GAMECUBE)
+    {
+        controllerType = JOYBUS_GAMECUBE;
+        GC_originValid = getGCOrigin();
+    }
+    else
+    {
+        controllerType = JOYBUS_N64;
+    }
+}
+
+static unsigned char gcCenter(unsigned char value, unsigned char origin)
+{
+    int16_t centered = (int16_t)value - origin + 128;
+
+    if (centered < 0)
+        return 0;
+    if (centered > 255)
+        return 255;
+    return centered;
+}
+
+static unsigned char gcTrigger(unsigned char value, unsigned char origin, bool clicked)
+{
+    if (clicked)
+        return 255;
+    return (value > origin) ? value - origin : 0;
+}
+
+/**
+ * The rest position of the GameCube pad's sticks and triggers. The reply has
+ * the layout of a poll reply plus two unused bytes. Until it got this
+ * command the pad keeps GC_BTN_ORIGIN set in its polls, after power up and
+ * after X + Y + Start.
+ */
+bool N64Controller::getGCOrigin()
+{
+    unsigned char command[] = {GC_ORIGIN};
+    unsigned char reply[GC_ORIGIN_REPLY_SIZE];
+
+    noInterrupts();
+    uint8_t bits = N64_send_data_request(command, 1, reply, sizeof(reply));
+    interrupts();
+
+    if (bits != sizeof(reply) * 8 || (reply[0] & 0x80) || !(reply[1] & 0x80))
+        return false;
+
+    memcpy(&GC_origin, reply, sizeof(GC_origin));
+    return true;
+}
+
+void N64Controller::getGCPacket()
+{
+    // reply bytes:
+    // 1: 0, 0, Origin, Start, Y, X, B, A
+    // 2: 1, L, R, Z, Dup, Ddown, Dright, Dleft
+    // 3, 4: main stick x, y
+    // 5, 6: C-stick x, y
+    // 7, 8: L, R analog
+    // Sticks are unsigned, centered near 128
+    unsigned char reply[8];
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        unsigned char command[] = {GC_POLL, GC_POLL_MODE, GC_rumble};
+        noInterrupts();
+        replyBits = N64_send_data_request(command, sizeof(command), reply, sizeof(reply));
+        interrupts();
+
+        if (replyBits == 0)
+        {
+            memset(&N64_status, 0, sizeof(N64_status));
+            controllerType = JOYBUS_NONE;
+            GC_rumble = false;
+            return;
+        }
+
+        // bit 7 of the first byte is the error flag, of the second always 1
+        if (replyBits == 64 && !(reply[0] & 0x80) && (reply[1] & 0x80))
+        {
+            // Sticks and triggers are relative to the origin the pad reports,
+            // like on the console. A pad without the origin command rests
+            // where it was at its first poll.
+            if (reply[0] & GC_BTN_ORIGIN)
+                GC_originValid = getGCOrigin() || GC_originValid;
+
+            if (!GC_originValid)
+            {
+                memcpy(&GC_origin, reply, sizeof(GC_origin));
+                GC_originValid = true;
+            }
+
+            GC_status.buttons1  = reply[0];
+            GC_status.buttons2  = reply[1];
+            GC_status.stick_x   = gcCenter(reply[2], GC_origin.stick_x);
+            GC_status.stick_y   = gcCenter(reply[3], GC_origin.stick_y);
+            GC_status.cstick_x  = gcCenter(reply[4], GC_origin.cstick_x);
+            GC_status.cstick_y  = gcCenter(reply[5], GC_origin.cstick_y);
+            GC_status.trigger_l = gcTrigger(reply[6], GC_origin.trigger_l, reply[1] & GC_BTN_L);
+            GC_status.trigger_r = gcTrigger(reply[7], GC_origin.trigger_r, reply[1] & GC_BTN_R);
+
+            gcToN64();
+            return;
+        }
+    }
+}
+
+// The GameCube pad as far as an N64 controller has the same controls
+void N64Controller::gcToN64()
+{
+    unsigned char buttons1 = GC_status.buttons1;
+    unsigned char buttons2 = GC_status.buttons2;
+
+    N64_status.data1 = (buttons1 & GC_BTN_A      ? 0x80 : 0) |
+                       (buttons1 & GC_BTN_B      ? 0x40 : 0) |
+                       (buttons2 & GC_BTN_Z      ? 0x20 : 0) |
+                       (buttons1 & GC_BTN_START  ? 0x10 : 0) |
+                       (buttons2 & (GC_BTN_DUP | GC_BTN_DDOWN)) |
+                       (buttons2 & GC_BTN_DLEFT  ? 0x02 : 0) |
+                       (buttons2 & GC_BTN_DRIGHT ? 0x01 : 0);
+
+    N64_status.data2 = (buttons2 & GC_BTN_L ? 0x20 : 0) |
+                       (buttons2 & GC_BTN_R ? 0x10 : 0) |
+                       (GC_status.cstick_y >= 128 + GC_C_THRESHOLD ? 0x08 : 0) |
+                       (GC_status.cstick_y <= 128 - GC_C_THRESHOLD ? 0x04 : 0) |
+                       (GC_status.cstick_x <= 128 - GC_C_THRESHOLD ? 0x02 : 0) |
+                       (GC_status.cstick_x >= 128 + GC_C_THRESHOLD ? 0x01 : 0);
+
+    N64_status.stick_x = GC_status.stick_x - 128;
+    N64_status.stick_y = GC_status.stick_y - 128;
 }
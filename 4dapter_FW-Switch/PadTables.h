@@ -0,0 +1,250 @@
+/*  PadTables.h
+ *
+ *  The button mapping tables of the sketch (VirtualPad.h): controller ->
+ *  virtual pad -> Switch report, the hotkeys and the HAT lookup. Kept out
+ *  of the sketch so the host tests check the same tables.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "SegaController32U4.h"
+#include "N64_Controller.h"
+#include "NESSNES_Scanner.h"
+#include "VirtualPad.h"
+
+#define DPAD_UP_MASK_ON         0x00
+#define DPAD_UPRIGHT_MASK_ON    0x01
+#define DPAD_RIGHT_MASK_ON      0x02
+#define DPAD_DOWNRIGHT_MASK_ON  0x03
+#define DPAD_DOWN_MASK_ON       0x04
+#define DPAD_DOWNLEFT_MASK_ON   0x05
+#define DPAD_LEFT_MASK_ON       0x06
+#define DPAD_UPLEFT_MASK_ON     0x07
+#define DPAD_NOTHING_MASK_ON    0x08
+
+#define Y_MASK_ON         0x01
+#define B_MASK_ON         0x02
+#define A_MASK_ON         0x04
+#define X_MASK_ON         0x08
+#define LB_MASK_ON        0x10
+#define RB_MASK_ON        0x20
+#define ZL_MASK_ON        0x40
+#define ZR_MASK_ON        0x80
+#define SELECT_MASK_ON    0x100
+#define START_MASK_ON     0x200
+#define L3_MASK_ON        0x400
+#define R3_MASK_ON        0x800
+#define HOME_MASK_ON      0x1000
+#define CAPTURE_MASK_ON   0x2000
+
+#define BUTTONUP      0
+#define BUTTONDOWN    1
+#define BUTTONLEFT    2
+#define BUTTONRIGHT   3
+#define BUTTONA       4
+#define BUTTONB       5
+#define BUTTONX       6
+#define BUTTONY       7
+#define BUTTONLB      8
+#define BUTTONRB      9
+#define BUTTONLT      10
+#define BUTTONRT      11
+#define BUTTONSTART   12
+#define BUTTONSELECT  13
+#define BUTTONHOME    14
+#define BUTTONCAPTURE 15
+#define BUTTONL3      16
+#define BUTTONR3      17
+
+#define PAD_DPAD  (PAD(BUTTONUP) | PAD(BUTTONDOWN) | PAD(BUTTONLEFT) | PAD(BUTTONRIGHT))
+
+// n64Data bits: N64Data.data1 | data2 << 8 | gcButtons << 16
+#define N64_RIGHT   0x000001
+#define N64_LEFT    0x000002
+#define N64_DOWN    0x000004
+#define N64_UP      0x000008
+#define N64_START   0x000010
+#define N64_Z       0x000020
+#define N64_B       0x000040
+#define N64_A       0x000080
+#define N64_R       0x001000
+#define N64_L       0x002000
+#define N64_RESET   0x008000  // L + R + Start on OEM controllers
+#define N64_GC_X    ((uint32_t)GC_BTN_X << 16)
+#define N64_GC_Y    ((uint32_t)GC_BTN_Y << 16)
+
+// Button mapping (VirtualPad.h): controller -> virtual pad -> Switch report.
+// The Genesis and N64 tables have a second layout the toggles switch to.
+
+// NES / SNES D-pad, both pads' AXES
+const PadMap DPAD_MAP[] PROGMEM =
+{
+  {UP,    PAD(BUTTONUP)},
+  {DOWN,  PAD(BUTTONDOWN)},
+  {LEFT,  PAD(BUTTONLEFT)},
+  {RIGHT, PAD(BUTTONRIGHT)},
+};
+
+const PadMap NES_MAP[] PROGMEM =
+{
+  {0x02, PAD(BUTTONA)},
+  {0x01, PAD(BUTTONB)},
+  {0x80, PAD(BUTTONSTART)},
+  {0x40, PAD(BUTTONSELECT)},
+};
+
+const PadMap SNES_MAP[] PROGMEM =
+{
+  {0x02, PAD(BUTTONA)},
+  {0x01, PAD(BUTTONB)},
+  {0x08, PAD(BUTTONX)},
+  {0x04, PAD(BUTTONY)},
+  {0x10, PAD(BUTTONLB)},
+  {0x20, PAD(BUTTONRB)},
+  {0x80, PAD(BUTTONSTART)},
+  {0x40, PAD(BUTTONSELECT)},
+};
+
+const PadMap GENESIS_MAP[] PROGMEM =
+{
+  {SC_BTN_UP,    PAD(BUTTONUP)},
+  {SC_BTN_DOWN,  PAD(BUTTONDOWN)},
+  {SC_BTN_LEFT,  PAD(BUTTONLEFT)},
+  {SC_BTN_RIGHT, PAD(BUTTONRIGHT)},
+  {SC_BTN_C,     PAD(BUTTONA)},
+  {SC_BTN_B,     PAD(BUTTONB)},
+  {SC_BTN_Y,     PAD(BUTTONX)},
+  {SC_BTN_A,     PAD(BUTTONY)},
+  {SC_BTN_X,     PAD(BUTTONLB)},
+  {SC_BTN_Z,     PAD(BUTTONRB)},
+  {SC_BTN_START, PAD(BUTTONSTART)},
+  {SC_BTN_MODE,  PAD(BUTTONSELECT)},
+  {SC_BTN_HOME,  PAD(BUTTONHOME)},
+};
+
+// Swap_Gen_Button: Y and Z swapped
+const PadMap GENESIS_MAP_SWAPPED[] PROGMEM =
+{
+  {SC_BTN_UP,    PAD(BUTTONUP)},
+  {SC_BTN_DOWN,  PAD(BUTTONDOWN)},
+  {SC_BTN_LEFT,  PAD(BUTTONLEFT)},
+  {SC_BTN_RIGHT, PAD(BUTTONRIGHT)},
+  {SC_BTN_C,     PAD(BUTTONA)},
+  {SC_BTN_B,     PAD(BUTTONB)},
+  {SC_BTN_Z,     PAD(BUTTONX)},
+  {SC_BTN_A,     PAD(BUTTONY)},
+  {SC_BTN_X,     PAD(BUTTONLB)},
+  {SC_BTN_Y,     PAD(BUTTONRB)},
+  {SC_BTN_START, PAD(BUTTONSTART)},
+  {SC_BTN_MODE,  PAD(BUTTONSELECT)},
+  {SC_BTN_HOME,  PAD(BUTTONHOME)},
+};
+
+// N64 and GameCube, the C-buttons are the right stick (buttonRead())
+const PadMap N64_MAP[] PROGMEM =
+{
+  {N64_UP,    PAD(BUTTONUP)},
+  {N64_DOWN,  PAD(BUTTONDOWN)},
+  {N64_LEFT,  PAD(BUTTONLEFT)},
+  {N64_RIGHT, PAD(BUTTONRIGHT)},
+  {N64_A,     PAD(BUTTONA)},
+  {N64_B,     PAD(BUTTONB)},
+  {N64_GC_X,  PAD(BUTTONX)},
+  {N64_GC_Y,  PAD(BUTTONY)},
+  {N64_L,     PAD(BUTTONLB)},
+  {N64_R,     PAD(BUTTONRB)},
+  {N64_Z,     PAD(BUTTONLT)},
+  {N64_START, PAD(BUTTONSTART)},
+};
+
+// Swap_N64_Button: B is X
+const PadMap N64_MAP_SWAPPED[] PROGMEM =
+{
+  {N64_UP,    PAD(BUTTONUP)},
+  {N64_DOWN,  PAD(BUTTONDOWN)},
+  {N64_LEFT,  PAD(BUTTONLEFT)},
+  {N64_RIGHT, PAD(BUTTONRIGHT)},
+  {N64_A,     PAD(BUTTONA)},
+  {N64_B,     PAD(BUTTONX)},
+  {N64_GC_X,  PAD(BUTTONX)},
+  {N64_GC_Y,  PAD(BUTTONY)},
+  {N64_L,     PAD(BUTTONLB)},
+  {N64_R,     PAD(BUTTONRB)},
+  {N64_Z,     PAD(BUTTONLT)},
+  {N64_START, PAD(BUTTONSTART)},
+};
+
+// Hotkey sources besides HOTKEY_PAD
+#define HOTKEY_N64      1 // n64Data
+#define HOTKEY_GENESIS3 2 // Genesis state, 3-button pads only
+
+// Checked in order, each one sees what the ones before left of the pad
+const PadHotkey HOTKEYS[] PROGMEM =
+{
+  // N64: In-Game Menu (D-Down + Start), Screenshot (D-Up + Start), Home (L + R + Start)
+  {HOTKEY_N64,      N64_DOWN | N64_START,                  PAD(BUTTONDOWN) | PAD(BUTTONSTART),                   PAD(BUTTONSELECT)},
+  {HOTKEY_N64,      N64_UP | N64_START,                    PAD(BUTTONUP) | PAD(BUTTONSTART),                     PAD(BUTTONCAPTURE)},
+  {HOTKEY_N64,      N64_RESET,                             PAD(BUTTONLB) | PAD(BUTTONRB) | PAD(BUTTONSTART),     PAD(BUTTONHOME)},
+  {HOTKEY_N64,      N64_L | N64_R | N64_START,             PAD(BUTTONLB) | PAD(BUTTONRB) | PAD(BUTTONSTART),     PAD(BUTTONHOME)},
+
+  // NES - SNES - Genesis: Home (Select/Mode + Start), In-Game Menu (Select/Mode + D-Down), Screenshot (Select/Mode + D-Up)
+  {HOTKEY_PAD,      PAD(BUTTONSELECT) | PAD(BUTTONSTART),  PAD(BUTTONSTART) | PAD(BUTTONSELECT),                 PAD(BUTTONHOME)},
+  {HOTKEY_PAD,      PAD(BUTTONSELECT) | PAD(BUTTONDOWN),   PAD(BUTTONSELECT) | PAD(BUTTONDOWN),                  PAD(BUTTONLT) | PAD(BUTTONRT)},
+  {HOTKEY_PAD,      PAD(BUTTONSELECT) | PAD(BUTTONUP),     PAD(BUTTONUP) | PAD(BUTTONSELECT),                    PAD(BUTTONCAPTURE)},
+
+  // Genesis 3-Button: In-Game Menu (A + B + C + Start), Home (A + D-Down + Start), Screenshot (A + D-Up + Start)
+  {HOTKEY_GENESIS3, SC_BTN_START | SC_BTN_A | SC_BTN_B | SC_BTN_C,
+                    PAD(BUTTONSTART) | PAD(BUTTONY) | PAD(BUTTONB) | PAD(BUTTONA),                                  PAD(BUTTONLT) | PAD(BUTTONRT)},
+  {HOTKEY_GENESIS3, SC_BTN_START | SC_BTN_A | SC_BTN_DOWN, PAD(BUTTONSTART) | PAD(BUTTONY) | PAD(BUTTONDOWN),     PAD(BUTTONHOME)},
+  {HOTKEY_GENESIS3, SC_BTN_START | SC_BTN_A | SC_BTN_UP,   PAD(BUTTONSTART) | PAD(BUTTONY) | PAD(BUTTONUP),       PAD(BUTTONCAPTURE)},
+};
+
+// Virtual pad -> Switch report buttons, the D-pad goes through DPAD_HAT
+const PadMap SWITCH_MAP[] PROGMEM =
+{
+  {PAD(BUTTONA),       A_MASK_ON},
+  {PAD(BUTTONB),       B_MASK_ON},
+  {PAD(BUTTONX),       X_MASK_ON},
+  {PAD(BUTTONY),       Y_MASK_ON},
+  {PAD(BUTTONLB),      LB_MASK_ON},
+  {PAD(BUTTONRB),      RB_MASK_ON},
+  {PAD(BUTTONLT),      ZL_MASK_ON},
+  {PAD(BUTTONRT),      ZR_MASK_ON},
+  {PAD(BUTTONSTART),   START_MASK_ON},
+  {PAD(BUTTONSELECT),  SELECT_MASK_ON},
+  {PAD(BUTTONHOME),    HOME_MASK_ON},
+  {PAD(BUTTONCAPTURE), CAPTURE_MASK_ON},
+  {PAD(BUTTONL3),      L3_MASK_ON},
+  {PAD(BUTTONR3),      R3_MASK_ON},
+};
+
+// HAT of the virtual pad's D-pad bits (UP, DOWN, LEFT, RIGHT = bits 0-3),
+// diagonals win over single directions, opposite directions don't cancel
+const uint8_t DPAD_HAT[16] PROGMEM =
+{
+  DPAD_NOTHING_MASK_ON,   DPAD_UP_MASK_ON,        DPAD_DOWN_MASK_ON,      DPAD_UP_MASK_ON,
+  DPAD_LEFT_MASK_ON,      DPAD_UPLEFT_MASK_ON,    DPAD_DOWNLEFT_MASK_ON,  DPAD_DOWNLEFT_MASK_ON,
+  DPAD_RIGHT_MASK_ON,     DPAD_UPRIGHT_MASK_ON,   DPAD_DOWNRIGHT_MASK_ON, DPAD_UPRIGHT_MASK_ON,
+  DPAD_LEFT_MASK_ON,      DPAD_UPRIGHT_MASK_ON,   DPAD_DOWNRIGHT_MASK_ON, DPAD_UPRIGHT_MASK_ON,
+};
+
+// Left stick of a HAT value with Swap_DPAD_JOY
+const uint8_t HAT_STICK_X[9] PROGMEM = {128, 255, 255, 255, 128, 0,   0,   0, 128};
+const uint8_t HAT_STICK_Y[9] PROGMEM = {0,   0,   128, 255, 255, 255, 128, 0, 128};
@@ -0,0 +1,54 @@
+/*  PortPresence.h
+ *
+ *  Backs off from empty controller ports. A port that returned a controller
+ *  on its last read is read every pass, an empty one only every
+ *  PRESENCE_PROBE_MS, so the loop is short with one controller plugged in.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define PRESENCE_PROBE_MS  100  // Read interval of an empty port, also the longest plug-in delay
+
+class PortPresence
+{
+  public:
+    PortPresence(void) : _present(true), _lastProbe(0) {}
+
+    // Time to check again whether the port is (still) in use
+    bool probeDue(unsigned long now) { return now - _lastProbe >= PRESENCE_PROBE_MS; }
+
+    // The port has to be read this pass
+    bool due(unsigned long now) { return _present || probeDue(now); }
+
+    // Result of a read that could tell
+    void update(bool present, unsigned long now)
+    {
+      _present = present;
+      _lastProbe = now;
+    }
+
+    bool present(void) { return _present; }
+
+  private:
+    bool          _present;
+    unsigned long _lastProbe;
+};
@@ -0,0 +1,97 @@
+/*  VirtualPad.h
+ *
+ *  Table driven button mapping. Every controller state is mapped onto one
+ *  packed "virtual pad" word, hotkeys are matched against it with mask /
+ *  compare entries and the virtual pad is mapped onto the report buttons
+ *  the same way. The tables live in flash (PROGMEM) next to the sketch's
+ *  other settings, a remap only touches them.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+// Virtual pad bit of a button index
+#define PAD(button)           (1UL << (button))
+
+// Entries of a PROGMEM table
+#define PAD_ENTRIES(table)    (sizeof(table) / sizeof((table)[0]))
+
+// Any of the 'from' bits presses all of the 'to' bits. A source bit may only
+// be in one entry of a table.
+typedef struct
+{
+  uint32_t from;
+  uint32_t to;
+} PadMap;
+
+// All of 'mask' held in state 'source' releases 'clear' and presses 'set'
+// on the virtual pad
+typedef struct
+{
+  uint8_t  source;
+  uint32_t mask;
+  uint32_t clear;
+  uint32_t set;
+} PadHotkey;
+
+#define HOTKEY_PAD  0 // The virtual pad itself, as left by the hotkeys before
+
+inline bool padHeld(uint32_t state, uint32_t mask)
+{
+  return (state & mask) == mask;
+}
+
+// Maps 'state' through a PROGMEM PadMap table, stops once all pressed
+// source bits are found
+inline uint32_t padMap(uint32_t state, const PadMap *map, uint8_t entries)
+{
+  uint32_t pad = 0;
+
+  for(uint8_t i = 0; i < entries && state; i++)
+  {
+    uint32_t from = pgm_read_dword(&map[i].from);
+
+    if(state & from)
+    {
+      pad   |= pgm_read_dword(&map[i].to);
+      state &= ~from;
+    }
+  }
+
+  return pad;
+}
+
+// Applies a PROGMEM PadHotkey table in order, 'sources' holds the states
+// the entries refer to (sources[HOTKEY_PAD] is not read)
+inline uint32_t padHotkeys(uint32_t pad, const uint32_t *sources, const PadHotkey *hotkeys, uint8_t entries)
+{
+  for(uint8_t i = 0; i < entries; i++)
+  {
+    uint8_t  source = pgm_read_byte(&hotkeys[i].source);
+    uint32_t mask   = pgm_read_dword(&hotkeys[i].mask);
+
+    if(padHeld(source == HOTKEY_PAD ? pad : sources[source], mask))
+      pad = (pad & ~pgm_read_dword(&hotkeys[i].clear)) | pgm_read_dword(&hotkeys[i].set);
+  }
+
+  return pad;
+}
@@ -20,10 +20,21 @@
 #include <XInput.h>
 #include "SegaController32U4.h"
 #include "N64_Controller.h"
+#include "N64Stick.h"
+#include "NESSNES_Scanner.h"
+#include "PortPresence.h"
+#include "PressLatch.h"
+#include "BusSampler.h"
 
-//Set N64 Joystick Maximum Travel Range (0-127, typically between 75-85 on OEM controllers)
+//Set N64 Joystick Maximum Travel Range until learned (0-127, typically between 75-85 on OEM controllers)
 #define N64JoyMax 80
 
+// XInput rumble to Rumble Pak. The pak motor is only on or off, weaker
+// requests run it for part of every RUMBLE_PWM_SLOTS slot period
+#define RUMBLE_THRESHOLD  24  // Motor strength (0-255) below this is off
+#define RUMBLE_SLOT_MS    16  // Shortest on or off time, bounds the Rumble Pak writes
+#define RUMBLE_PWM_SLOTS  8
+
 N64Controller       n64_controller;
 N64_status_packet   N64Data;
 
@@ -32,110 +43,62 @@ int16_t LeftY = 128;
 int16_t RightX = 128;
 int16_t RightY = 128;
 
-#define NES       0
-#define SNES      1
 #define GENESIS   2
 
-#define BUTTONS   0
-#define AXES      1
-
-#define UP        0x01
-#define DOWN      0x02
-#define LEFT      0x04
-#define RIGHT     0x08
-
-#define NTT_BIT   0x00
-#define NODATA    0x00
-
-void sendLatch();
-void sendClock();
 void sendState();
+bool rumbleDuty();
+bool reportDelivered();
 
 // Manage EEPROM by making sure everything has
 // its own index.
-enum EEPROMIndices { GENESIS_EEPROM };
+// N64_STICK_EEPROM takes N64_STICK_EEPROM_SIZE bytes.
+enum EEPROMIndices { GENESIS_EEPROM, N64_STICK_EEPROM };
 
 // Set up USB HID gamepads
 SegaController32U4 controller(GENESIS_EEPROM);
 
+// N64 stick conversion and travel calibration, see N64Stick.h
+N64Stick n64Stick(N64_STICK_EEPROM, N64_STICK_UNSIGNED, false, N64JoyMax, 0, true);
+
 // Controllers
-uint32_t  controllerData[2][2] = {{0,0},{0,0}};
-uint32_t  axisIndicator[32] = {0,0,0,0,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+NESSNESScanner scanner;
+uint32_t  busData[2][2] = {{0,0},{0,0}};         // As scanned
+uint32_t  controllerData[2][2] = {{0,0},{0,0}};  // As reported
 uint16_t  currentGenesisState = 0;
-bool      nttActive = false;
-
-uint32_t  dataMaskNES[8] =        {0x02,   // A
-                                   0x01,   // B
-                                   0x40,   // Start 
-                                   0x80,   // Select
-                                   UP,     // D-Up
-                                   DOWN,   // D-Down
-                                   LEFT,   // D-Left
-                                   RIGHT   // D-Right
-                                   }; 
-
-// Power Pad D4
-uint32_t  dataMaskPowerPadD4[8] = {0x08,    // PowerPad #4
-                                   0x04,    // PowerPad #3
-                                   0x800,   // PowerPad #12
-                                   0x80,    // PowerPad #8
-                                   NODATA,  // No Data
-                                   NODATA,  // No Data
-                                   NODATA,  // No Data
-                                   NODATA   // No Data
-                                   }; 
-
-// Power Pad D3
-uint32_t  dataMaskPowerPadD3[8] = {0x02,   // PowerPad #2
-                                   0x01,   // PowerPad #1
-                                   0x10,   // PowerPad #5
-                                   0x100,  // PowerPad #9
-                                   0x20,   // PowerPad #6
-                                   0x200,  // PowerPad #10
-                                   0x400,  // PowerPad #11
-                                   0x40    // PowerPad #7
-                                   }; 
-
-uint32_t  dataMaskSNES[32] =      {0x01,    // B
-                                   0x04,    // Y
-                                   0x40,    // Start   
-                                   0x80,    // Select
-                                   UP,      // D-Up
-                                   DOWN,    // D-Down
-                                   LEFT,    // D-Left
-                                   RIGHT,   // D-Right
-                                   0x02,    // A
-                                   0x08,    // X
-                                   0x10,    // L
-                                   0x20,    // R
-                                   NODATA,  // SNES Control Bit
-                                   NTT_BIT, // NTT Indicator Bit
-                                   NODATA,  // SNES Control Bit
-                                   NODATA,  // SNES Control Bit
-                                   0x100,   // NTT 0
-                                   0x200,   // NTT 1
-                                   0x400,   // NTT 2
-                                   0x800,   // NTT 3
-                                   0x1000,  // NTT 4
-                                   0x2000,  // NTT 5
-                                   0x4000,  // NTT 6
-                                   0x8000,  // NTT 7
-                                   0x10000, // NTT 8
-                                   0x20000, // NTT 9
-                                   0x40000, // NTT *
-                                   0x80000, // NTT #
-                                   0x100000,// NTT .
-                                   0x200000,// NTT C
-                                   NODATA,  // NTT No Data
-                                   0x800000,// NTT End Comms
-                                   };
+uint16_t  gcButtons = 0;                         // GameCube B / X / Y (buttons1), Z (buttons2) << 8
+
+// Empty ports are only probed every PRESENCE_PROBE_MS
+PortPresence genesisPort;
+PortPresence busPort;     // NES/SNES/Power Pad, one shared latch and clock
+PortPresence n64Port;
+
+#if (PRESS_LATCH == true)
+// Presses held until the host collected a report with them, see PressLatch.h.
+// The loop scans again while the report is unchanged, taps in between are kept.
+PressLatch busLatch[2][2];  // busData
+PressLatch genesisLatch;
+PressLatch n64Latch;        // N64Data.data1 | data2 << 8 | gcButtons << 16
+#define LATCH(latch, pressed)  (latch).sample(pressed)
+#else
+#define LATCH(latch, pressed)  (pressed)
+#endif
+
+// Unchanged reports are sent again after this many ms, 0 sends only changes
+#ifndef XINPUT_KEEPALIVE_MS
+#define XINPUT_KEEPALIVE_MS 100
+#endif
+
+// Endpoint XInput.send() writes to, see the XInput AVR core
+#ifndef XINPUT_TX_ENDPOINT
+#define XINPUT_TX_ENDPOINT 1
+#endif
 
 void setup()
 {
+  XInput.begin(); // Receives the rumble packets
   XInput.setAutoSend(false);
   XInput.setRange(JOY_LEFT,  0, 255);
   XInput.setRange(JOY_RIGHT, 0, 255);
-  XInput.setRange(TRIGGER_RIGHT, 0, 1);
 
   n64_controller.N64_init();
 
@@ -160,108 +123,149 @@ void setup()
   PORTB |= B00000100; // high
 
   delay(250);
+
+#if (BUS_SAMPLER == true)
+  busSampler.begin();
+#endif
 }
 
 void loop() 
 {     
     currentGenesisState = 0;
-    
-    //8 cycles needed to capture 6-button controllers
-    for(uint8_t i = 0; i < 8; i++)
+    unsigned long now = millis();
+
+#if (PRESS_LATCH == true)
+    // Every pass with nothing pending, also while sendState() skips unchanged reports
+    if(reportDelivered())
     {
-      currentGenesisState = controller.updateState();
+      for(uint8_t i = 0; i < 2; i++)
+      {
+        busLatch[i][BUTTONS].delivered();
+        busLatch[i][AXES].delivered();
+      }
+      genesisLatch.delivered();
+      n64Latch.delivered();
     }
-
-    currentGenesisState = controller.getFinalState();
+#endif
     
-    for(uint8_t j = 0; j < 1; j++)
+#if (BUS_SAMPLER == true)
+    // Scanned by the Timer3 interrupt
+    bool busDue = false;
+    bool busProbe = false;
+#else
+    // The probe runs past the shift registers, every PRESENCE_PROBE_MS also
+    // with pads present to notice them being unplugged
+    bool busDue = busPort.due(now);
+    bool busProbe = busPort.probeDue(now);
+#endif
+
+    //8 cycles needed to capture 6-button controllers, the select line settle
+    //time of each one is spent clocking the NES/SNES bus. An empty port is
+    //left alone until it is probed again or a line goes low (SMS/Atari pads
+    //can't be told from an empty port until pressed).
+    if(busDue)
+      scanner.begin(busProbe);
+
+    if(genesisPort.due(now) || controller.inputActive())
     {
-      sendLatch();
+      for(uint8_t i = 0; i < 8; i++)
+      {
+        controller.toggleSelect();
 
-      controllerData[NES][BUTTONS] = 0;
-      controllerData[NES][AXES] = 0;
-      
-      controllerData[SNES][BUTTONS] = 0;
-      controllerData[SNES][AXES] = 0;
+        if(busDue)
+          scanner.stepFor(SC_CYCLE_DELAY);
+        else
+          delayMicroseconds(SC_CYCLE_DELAY);
 
-      nttActive = false;
-  
-      for(uint8_t dataBitCounter = 0; dataBitCounter < 32; dataBitCounter++)
+        currentGenesisState = controller.readState();
+      }
+
+      currentGenesisState = controller.getFinalState();
+      genesisPort.update(controller.connected() || currentGenesisState != 0, now);
+    }
+
+    currentGenesisState = LATCH(genesisLatch, currentGenesisState);
+
+    if(busDue)
+    {
+      while(scanner.step());
+      scanner.finish(busData);
+
+      if(busProbe)
       {
-        // If no NTT controller, end the loop early
-        if(!nttActive && dataBitCounter > 13)
-        {
-          break;
-        }
-
-        //NES Power Pad Controller
-        if((dataBitCounter < 8) && ((PINB & B00100000) == 0)) //Power Pad Pin D4 (bottom)
-        { 
-          controllerData[NES][BUTTONS] |= dataMaskPowerPadD4[dataBitCounter];
-        }
-
-        if((dataBitCounter < 8) && ((PINB & B00010000) == 0)) //Power Pad Pin D3 (middle)
-        { 
-          controllerData[NES][BUTTONS] |= dataMaskPowerPadD3[dataBitCounter];
-        }
-
-        // NES Controller
-        if((dataBitCounter < 8) && ((PINF & B10000000) == 0)) //If NES data line is low (indicating a press)
-        { 
-          if(axisIndicator[dataBitCounter])
-          {
-            controllerData[NES][AXES] |= dataMaskNES[dataBitCounter];
-          }
-          else
-          {
-            controllerData[NES][BUTTONS] |= dataMaskNES[dataBitCounter];
-          }
-        }
-
-        // SNES / NTT Controller 
-        if((PINF & B01000000) == 0) //If SNES data line is low (indicating a press)
-        {
-          if(dataBitCounter == 13)
-          {
-            nttActive = true;
-          }
-          
-          if(axisIndicator[dataBitCounter])
-          {
-            controllerData[SNES][AXES] |= dataMaskSNES[dataBitCounter];
-          }
-          else
-          {
-            controllerData[SNES][BUTTONS] |= dataMaskSNES[dataBitCounter];
-          }
-        }
-        
-        sendClock();
+        busPort.update(scanner.padsPresent, now);
+
+        // Pads plugged in or out, find the latch/clock timing they all keep up with
+        if(scanner.padsChanged)
+          scanner.calibrate();
       }
-    }    
+    }
+#if (BUS_SAMPLER == true)
+    busSampler.read(busData);
+#endif
 
-  n64_controller.getN64Packet();
+    for(uint8_t i = 0; i < 2; i++)
+    {
+      controllerData[i][BUTTONS] = LATCH(busLatch[i][BUTTONS], busData[i][BUTTONS]);
+      controllerData[i][AXES]    = LATCH(busLatch[i][AXES], busData[i][AXES]);
+    }
+
+  if(n64Port.due(now))
+  {
+    n64_controller.getN64Packet();
+    n64Port.update(n64_controller.controllerType != JOYBUS_NONE, now);
+  }
   N64Data = n64_controller.N64_status;
+
+  // GameCube pad: A, Start and the D-pad go the N64 way, the rest is mapped
+  // from GC_status in sendState()
+  gcButtons = 0;
+  if (n64_controller.controllerType == JOYBUS_GAMECUBE)
+  {
+    GC_status_packet &gc = n64_controller.GC_status;
+    N64Data.data1 &= ~0x60; // B, Z
+    N64Data.data2 = 0;      // L, R, C buttons
+    gcButtons = (gc.buttons1 & (GC_BTN_B | GC_BTN_X | GC_BTN_Y)) | ((gc.buttons2 & GC_BTN_Z) << 8);
+  }
+
+  uint32_t n64State = LATCH(n64Latch, N64Data.data1 | (N64Data.data2 << 8) | ((uint32_t)gcButtons << 16));
+  N64Data.data1 = n64State;
+  N64Data.data2 = n64State >> 8;
+  gcButtons     = n64State >> 16;
   
   sendState();
+
+  // sendState() doesn't wait for the host, one Rumble Pak write per pass.
+  // Nothing is queued for an empty port.
+  n64_controller.setRumble(n64Port.present() && rumbleDuty());
+  n64_controller.serviceRumble();
 }
 
-void sendLatch()
+// The host collected every report sent so far
+bool reportDelivered()
 {
-  // Send a latch pulse to NES/SNES
-  PORTD |=  B00000010; // Set HIGH
-  __builtin_avr_delay_cycles(192);
-  PORTD &= ~B00000010; // Set LOW
-  __builtin_avr_delay_cycles(72);
+  // The USB interrupt changes UENUM without restoring it
+  uint8_t sreg = SREG;
+  cli();
+
+  UENUM = XINPUT_TX_ENDPOINT;
+  bool empty = !(UESTA0X & ((1 << NBUSYBK1) | (1 << NBUSYBK0)));
+
+  SREG = sreg;
+  return empty;
 }
 
-void sendClock()
+bool rumbleDuty()
 {
-  // Send a clock pulse to NES/SNES
-  PORTD |=  B00000001; // Set HIGH
-  __builtin_avr_delay_cycles(96);
-  PORTD &= ~B00000001; // Set LOW
-  __builtin_avr_delay_cycles(72);
+  uint8_t strength = max(XInput.getRumbleLeft(), XInput.getRumbleRight());
+
+  if (strength < RUMBLE_THRESHOLD)
+    return false;
+
+  uint8_t onSlots = ((uint16_t)strength * RUMBLE_PWM_SLOTS + 128) >> 8;
+  uint8_t slot = (millis() / RUMBLE_SLOT_MS) % RUMBLE_PWM_SLOTS;
+
+  return slot < onSlots;
 }
 
 
@@ -288,56 +292,133 @@ void sendClock()
   
  */
 
-void sendState()
-{ 
-  // Reset all cached button presses to force a full update every cycle.
-  XInput.releaseAll();
-
-  // Use controller data from all 3 inputs to map to single XInput Controller (takes about 350us per controller cycle)
-  XInput.setButton(BUTTON_A,   (controllerData[NES][BUTTONS] & 0x01)  | (controllerData[SNES][BUTTONS] & 0x01) | (currentGenesisState & SC_BTN_B)     | (N64Data.data1 & 0x80 ? 1:0) );
-  XInput.setButton(BUTTON_B,   (controllerData[NES][BUTTONS] & 0x02)  | (controllerData[SNES][BUTTONS] & 0x02) | (currentGenesisState & SC_BTN_C)     | (N64Data.data2 & 0x04 ? 1:0) );
-  XInput.setButton(BUTTON_X,   (controllerData[SNES][BUTTONS] & 0x04) | (currentGenesisState & SC_BTN_A) | (N64Data.data1 & 0x40 ? 1:0));
-  XInput.setButton(BUTTON_Y,   (controllerData[SNES][BUTTONS] & 0x08) | (currentGenesisState & SC_BTN_Y) | (N64Data.data2 & 0x02 ? 1:0));
-  XInput.setButton(BUTTON_L3,  (N64Data.data2 & 0x08 ? 1:0));
-  XInput.setButton(BUTTON_R3,  (N64Data.data2 & 0x01 ? 1:0));
-  XInput.setTrigger(TRIGGER_RIGHT, (N64Data.data1 & 0x20 ? 1:0));
+// Everything one XInput report carries, built every pass but only handed to
+// the XInput library when it differs from the one sent last
+typedef struct
+{
+  uint16_t buttons;       // XBUTTON(BUTTON_*), XBUTTON(DPAD_*)
+  uint8_t  triggerLeft;
+  uint8_t  triggerRight;
+  int16_t  leftX, leftY;
+  int16_t  rightX, rightY;
+} XInputReport;
 
-  XInput.setDpad( (controllerData[NES][AXES] & UP)          |  (controllerData[SNES][AXES] & UP)          | ((currentGenesisState & SC_BTN_UP) >> SC_BIT_SH_UP)       | (N64Data.data1 & 0x08 ? 1:0), 
-                 ((controllerData[NES][AXES] & DOWN) >> 1)  | ((controllerData[SNES][AXES] & DOWN) >> 1)  | ((currentGenesisState & SC_BTN_DOWN) >> SC_BIT_SH_DOWN)   | (N64Data.data1 & 0x04 ? 1:0), 
-                 ((controllerData[NES][AXES] & LEFT) >> 2)  | ((controllerData[SNES][AXES] & LEFT) >> 2)  | ((currentGenesisState & SC_BTN_LEFT) >> SC_BIT_SH_LEFT)   | (N64Data.data1 & 0x02 ? 1:0), 
-                 ((controllerData[NES][AXES] & RIGHT) >> 3) | ((controllerData[SNES][AXES] & RIGHT) >> 3) | ((currentGenesisState & SC_BTN_RIGHT) >> SC_BIT_SH_RIGHT) | (N64Data.data1 & 0x01 ? 1:0),
-                true);
+#define XBUTTON(control)        (1U << (control))
+#define XPRESS(control, press)  ((press) ? XBUTTON(control) : 0)
 
-  XInput.setButton(BUTTON_LB,     (controllerData[SNES][BUTTONS] & 0x10) | (currentGenesisState & SC_BTN_X) | (N64Data.data2 & 0x20 ? 1:0));
-  XInput.setButton(BUTTON_RB,     (controllerData[SNES][BUTTONS] & 0x20) | (currentGenesisState & SC_BTN_Z) | (N64Data.data2 & 0x10 ? 1:0));
-  XInput.setButton(BUTTON_BACK,   (controllerData[NES][BUTTONS] & 0x40) | (controllerData[SNES][BUTTONS] & 0x40) | (currentGenesisState & SC_BTN_MODE) );
-  XInput.setButton(BUTTON_START,  (controllerData[NES][BUTTONS] & 0x80) | (controllerData[SNES][BUTTONS] & 0x80) | (currentGenesisState & SC_BTN_START) | (N64Data.data1 & 0x10 ? 1:0) );
-  XInput.setButton(BUTTON_LOGO,   (currentGenesisState & SC_BTN_HOME));
+XInputReport  lastReport;          // As last accepted by XInput.send()
+unsigned long lastReportTime = 0;
+uint8_t       lastReportFrame = 0;
 
+void buildReport(XInputReport &report)
+{
+  report.buttons =
+    XPRESS(BUTTON_A,     (controllerData[NES][BUTTONS] & 0x01) | (controllerData[SNES][BUTTONS] & 0x01) | (currentGenesisState & SC_BTN_B) | (N64Data.data1 & 0x80)) |
+    XPRESS(BUTTON_B,     (controllerData[NES][BUTTONS] & 0x02) | (controllerData[SNES][BUTTONS] & 0x02) | (currentGenesisState & SC_BTN_C) | (N64Data.data2 & 0x04)) |
+    XPRESS(BUTTON_X,     (controllerData[SNES][BUTTONS] & 0x04) | (currentGenesisState & SC_BTN_A) | (N64Data.data1 & 0x40)) |
+    XPRESS(BUTTON_Y,     (controllerData[SNES][BUTTONS] & 0x08) | (currentGenesisState & SC_BTN_Y) | (N64Data.data2 & 0x02)) |
+    XPRESS(BUTTON_L3,    (N64Data.data2 & 0x08)) |
+    XPRESS(BUTTON_R3,    (N64Data.data2 & 0x01)) |
+    XPRESS(BUTTON_LB,    (controllerData[SNES][BUTTONS] & 0x10) | (currentGenesisState & SC_BTN_X) | (N64Data.data2 & 0x20)) |
+    XPRESS(BUTTON_RB,    (controllerData[SNES][BUTTONS] & 0x20) | (currentGenesisState & SC_BTN_Z) | (N64Data.data2 & 0x10)) |
+    XPRESS(BUTTON_BACK,  (controllerData[NES][BUTTONS] & 0x40) | (controllerData[SNES][BUTTONS] & 0x40) | (currentGenesisState & SC_BTN_MODE)) |
+    XPRESS(BUTTON_START, (controllerData[NES][BUTTONS] & 0x80) | (controllerData[SNES][BUTTONS] & 0x80) | (currentGenesisState & SC_BTN_START) | (N64Data.data1 & 0x10)) |
+    XPRESS(BUTTON_LOGO,  (currentGenesisState & SC_BTN_HOME)) |
+    XPRESS(DPAD_UP,      (controllerData[NES][AXES] & UP)    | (controllerData[SNES][AXES] & UP)    | (currentGenesisState & SC_BTN_UP)    | (N64Data.data1 & 0x08)) |
+    XPRESS(DPAD_DOWN,    (controllerData[NES][AXES] & DOWN)  | (controllerData[SNES][AXES] & DOWN)  | (currentGenesisState & SC_BTN_DOWN)  | (N64Data.data1 & 0x04)) |
+    XPRESS(DPAD_LEFT,    (controllerData[NES][AXES] & LEFT)  | (controllerData[SNES][AXES] & LEFT)  | (currentGenesisState & SC_BTN_LEFT)  | (N64Data.data1 & 0x02)) |
+    XPRESS(DPAD_RIGHT,   (controllerData[NES][AXES] & RIGHT) | (controllerData[SNES][AXES] & RIGHT) | (currentGenesisState & SC_BTN_RIGHT) | (N64Data.data1 & 0x01));
+
+  report.triggerLeft  = 0;
+  report.triggerRight = (N64Data.data1 & 0x20 ? 255:0);
 
   if(N64Data.data2 & 0x80) //Use N64 "reset" as Back button without sending shoulder buttons
   {
-    XInput.setButton(BUTTON_LB,   0);
-    XInput.setButton(BUTTON_RB,   0);
-    XInput.setButton(BUTTON_BACK, 1);
+    report.buttons &= ~(XBUTTON(BUTTON_LB) | XBUTTON(BUTTON_RB));
+    report.buttons |= XBUTTON(BUTTON_BACK);
   }
 
   //////////////////////////////////////////
 
-  N64Data.stick_y = -N64Data.stick_y;
+  if (n64_controller.controllerType == JOYBUS_GAMECUBE)
+  {
+    GC_status_packet &gc = n64_controller.GC_status;
+
+    report.buttons |= XPRESS(BUTTON_B,  gcButtons & GC_BTN_B) |
+                      XPRESS(BUTTON_X,  gcButtons & GC_BTN_X) |
+                      XPRESS(BUTTON_Y,  gcButtons & GC_BTN_Y) |
+                      XPRESS(BUTTON_RB, (gcButtons >> 8) & GC_BTN_Z);
+    report.triggerLeft  = gc.trigger_l;
+    report.triggerRight = gc.trigger_r;
+
+    // Full range sticks, the N64 stick calibration doesn't apply
+    LeftX  = gc.stick_x;
+    LeftY  = gc.stick_y;
+    RightX = gc.cstick_x;
+    RightY = gc.cstick_y;
+  }
+  else
+  {
+    n64Stick.update(N64Data);
+    LeftX  = n64Stick.x(N64Data.stick_x);
+    LeftY  = n64Stick.y(N64Data.stick_y);
+    RightX = 128;
+    RightY = 128;
+  }
+
+  report.leftX  = LeftX;
+  report.leftY  = LeftY;
+  report.rightX = RightX;
+  report.rightY = RightY;
+}
+
+void sendState()
+{ 
+  XInputReport report;
+  buildReport(report);
 
-  if(N64Data.stick_x > N64JoyMax)   N64Data.stick_x = N64JoyMax;
-  if(N64Data.stick_x < -N64JoyMax)  N64Data.stick_x = -N64JoyMax;
-  if(N64Data.stick_y > N64JoyMax)   N64Data.stick_y = N64JoyMax;
-  if(N64Data.stick_y < -N64JoyMax)  N64Data.stick_y = -N64JoyMax;
+  bool keepAlive = (XINPUT_KEEPALIVE_MS > 0) && (millis() - lastReportTime >= XINPUT_KEEPALIVE_MS);
 
-  LeftX = map(N64Data.stick_x, -N64JoyMax, N64JoyMax, 0, 255);
-  LeftY = map(-N64Data.stick_y, -N64JoyMax, N64JoyMax, 0, 255);
+  // The host already holds this report. The latches count it as carrying
+  // their presses (see PressLatch.h), so a release is not held back until
+  // the keep-alive.
+  if(!keepAlive && memcmp(&report, &lastReport, sizeof(report)) == 0)
+    return;
 
-  XInput.setJoystick(JOY_LEFT, LeftX, LeftY);
-  XInput.setJoystick(JOY_RIGHT, RightX, RightY);
+  // At most one report per USB frame, and only once the host has collected
+  // the previous one. send() then never waits for a bank and the loop goes
+  // on scanning the pads instead (a blocking send took 1.4-1.5 ms on MiSTer
+  // and 3-4 ms on the Analogue Pocket Dock).
+  if(UDFNUML == lastReportFrame || !reportDelivered())
+    return;
 
-  // Takes about 1.4-1.5ms to send USB Packet on MiSTer (at 1000hz polling rate)
-  // Takes about 3-4ms to send USB Packet on Analogue Pocket Dock (likely 250hz polling rate)
-  XInput.send(); 
+  // releaseAll() has send() transmit even when the library's copy is unchanged
+  XInput.releaseAll();
+
+  for(uint8_t button = BUTTON_LOGO; button <= BUTTON_R3; button++)
+    XInput.setButton(button, report.buttons & XBUTTON(button));
+
+  XInput.setDpad(report.buttons & XBUTTON(DPAD_UP), report.buttons & XBUTTON(DPAD_DOWN),
+                 report.buttons & XBUTTON(DPAD_LEFT), report.buttons & XBUTTON(DPAD_RIGHT), true);
+  XInput.setTrigger(TRIGGER_LEFT,  report.triggerLeft);
+  XInput.setTrigger(TRIGGER_RIGHT, report.triggerRight);
+  XInput.setJoystick(JOY_LEFT,  report.leftX,  report.leftY);
+  XInput.setJoystick(JOY_RIGHT, report.rightX, report.rightY);
+
+  if(XInput.send() <= 0)
+    return;
+
+  lastReport      = report;
+  lastReportTime  = millis();
+  lastReportFrame = UDFNUML;
+
+#if (PRESS_LATCH == true)
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    busLatch[i][BUTTONS].sent();
+    busLatch[i][AXES].sent();
+  }
+  genesisLatch.sent();
+  n64Latch.sent();
+#endif
 }
@@ -0,0 +1,229 @@
+/*  N64Stick.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+
+#include "Arduino.h"
+#include "N64Stick.h"
+
+// Marks a saved calibration in EEPROM
+static const uint8_t kCalibrationMarker = 0x64;
+
+// Highest value a stick can report in one direction
+#define N64_STICK_MAX_TRAVEL 127
+
+// Status byte 2, set by the controller while L + R + Start re-centers the stick
+#define N64_STICK_RESET_BIT 0x80
+
+#if (N64_STICK_CURVE == true)
+// (t + t^2) / 2 over 0..127
+static const uint8_t kCurve[128] PROGMEM =
+{
+    0,   1,   1,   2,   2,   3,   3,   4,   4,   5,   5,   6,   7,   7,   8,   8,
+    9,  10,  10,  11,  12,  12,  13,  14,  14,  15,  16,  16,  17,  18,  19,  19,
+   20,  21,  22,  22,  23,  24,  25,  25,  26,  27,  28,  29,  30,  30,  31,  32,
+   33,  34,  35,  36,  37,  38,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,
+   48,  49,  50,  51,  52,  53,  54,  55,  56,  57,  59,  60,  61,  62,  63,  64,
+   65,  66,  67,  69,  70,  71,  72,  73,  74,  76,  77,  78,  79,  81,  82,  83,
+   84,  86,  87,  88,  89,  91,  92,  93,  95,  96,  97,  99, 100, 101, 103, 104,
+  105, 107, 108, 110, 111, 112, 114, 115, 117, 118, 120, 121, 123, 124, 126, 127
+};
+#endif
+
+N64Stick::N64Stick(int eeprom_index, uint8_t format, bool invertY, uint8_t travel, uint8_t deadzone, bool scale)
+    : _eeprom_index(eeprom_index),
+      _format(format),
+      _invertY(invertY),
+      _deadzone(deadzone),
+      _scale(scale)
+{
+    _dirty = false;
+    _resetHeld = false;
+    _saveIndex = N64_STICK_EEPROM_SIZE;
+
+    for (uint8_t d = 0; d < 4; d++)
+        _beyond[d] = 0;
+
+    load(travel);
+
+    for (uint8_t d = 0; d < 4; d++)
+        build(d);
+}
+
+void N64Stick::load(uint8_t travel)
+{
+    bool valid = (EEPROM.read(_eeprom_index) == kCalibrationMarker);
+
+    for (uint8_t d = 0; d < 4; d++)
+    {
+        uint8_t saved = EEPROM.read(_eeprom_index + 1 + d);
+
+        if (saved < N64_STICK_MIN_TRAVEL || saved > N64_STICK_MAX_TRAVEL)
+            valid = false;
+
+        _travel[d] = saved;
+    }
+
+    if (!valid)
+    {
+        for (uint8_t d = 0; d < 4; d++)
+            _travel[d] = travel;
+    }
+}
+
+// One byte per call, and only once the EEPROM finished the last one: a
+// write takes ~3.4ms, far too long to wait for in the loop. The marker goes
+// last so a save cut short by unplugging leaves a valid calibration behind.
+void N64Stick::save()
+{
+    if (_saveIndex >= N64_STICK_EEPROM_SIZE || !eeprom_is_ready())
+        return;
+
+    if (_saveIndex < 4)
+        EEPROM.update(_eeprom_index + 1 + _saveIndex, _travel[_saveIndex]);
+    else
+        EEPROM.update(_eeprom_index, kCalibrationMarker);
+
+    _saveIndex++;
+}
+
+void N64Stick::build(uint8_t direction)
+{
+    // Rounded up, this matches the integer division for every span 1..127
+    uint8_t span = _travel[direction] - _deadzone;
+    _factor[direction] = ((127UL << 16) + span - 1) / span;
+}
+
+uint8_t N64Stick::convert(uint8_t axis, int8_t raw) const
+{
+    bool negative = (raw < 0);
+    uint8_t direction = axis + negative;
+    bool invert = (axis != 0) && _invertY;
+    bool down = (negative != invert); // Output goes towards -128
+
+    uint8_t magnitude = negative ? -raw : raw; // -128 becomes 128
+    uint8_t travel = _travel[direction];
+    int16_t value;
+
+    if (magnitude <= _deadzone)
+    {
+        value = 0;
+    }
+    else if (!_scale)
+    {
+        value = magnitude;
+    }
+    else
+    {
+        if (magnitude > travel)
+            magnitude = travel;
+
+        // Deflection past the deadzone as 0..127
+        uint8_t position = ((magnitude - _deadzone) * _factor[direction]) >> 16;
+
+#if (N64_STICK_CURVE == true)
+        value = pgm_read_byte(&kCurve[position]);
+#else
+        value = position;
+#endif
+
+        // Full deflection reaches -128
+        if (down && value >= 64)
+            value++;
+    }
+
+    if (down)
+        value = -value;
+
+    if (value > 127)
+        value = 127;
+
+    if (_format == N64_STICK_UNSIGNED)
+        value += 128;
+
+    return (uint8_t)value;
+}
+
+void N64Stick::update(const N64_status_packet &status)
+{
+    int8_t raw[2] = { status.stick_x, status.stick_y };
+
+    // Re-centering: start over from the minimum travel
+    bool reset = (status.data2 & N64_STICK_RESET_BIT);
+
+    if (reset && !_resetHeld)
+    {
+        for (uint8_t d = 0; d < 4; d++)
+        {
+            _travel[d] = N64_STICK_MIN_TRAVEL;
+            _beyond[d] = 0;
+            build(d);
+        }
+
+        _dirty = true;
+    }
+    _resetHeld = reset;
+
+    bool centered = true;
+
+    for (uint8_t axis = 0; axis < 2; axis++)
+    {
+        int16_t value = raw[axis];
+        uint8_t direction = axis * 2 + (value < 0);
+        uint8_t magnitude = (value < 0) ? -value : value;
+
+        if (magnitude > N64_STICK_MAX_TRAVEL)
+            magnitude = N64_STICK_MAX_TRAVEL;
+
+        // Grows to the smallest of the reads in a row past it, a glitch
+        // on a single read is dropped
+        if (magnitude > _travel[direction])
+        {
+            if (_beyond[direction] == 0 || magnitude < _reach[direction])
+                _reach[direction] = magnitude;
+
+            if (++_beyond[direction] >= N64_STICK_GROW_READINGS)
+            {
+                _travel[direction] = _reach[direction];
+                _beyond[direction] = 0;
+                build(direction);
+                _dirty = true;
+            }
+        }
+        else
+        {
+            _beyond[direction] = 0;
+        }
+
+        if (magnitude > _deadzone)
+            centered = false;
+    }
+
+    // Only write while the stick rests, not on every step of a turn
+    if (_dirty && centered)
+    {
+        _dirty = false;
+        _saveIndex = 0;
+    }
+
+    save();
+}
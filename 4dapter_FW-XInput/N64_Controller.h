@@ -11,6 +11,8 @@
 #ifndef N64Controller_h
 #define N64Controller_h
 
+#include <stdint.h>
+
 #define N64_PIN     10
 #define N64_PIN_DIR DDRB
 
@@ -34,20 +36,109 @@ typedef struct state
     unsigned char data2;
 } N64_status_packet;
 
+// GameCube poll reply, the sticks origin corrected and centered at 128
+typedef struct
+{
+    // bits: 0, 0, origin, start, y, x, b, a
+    unsigned char buttons1;
+
+    // bits: 1, L, R, Z, Dup, Ddown, Dright, Dleft
+    unsigned char buttons2;
+
+    unsigned char stick_x;
+    unsigned char stick_y;
+    unsigned char cstick_x;
+    unsigned char cstick_y;
+    unsigned char trigger_l;  // 255 once the trigger clicks
+    unsigned char trigger_r;
+} GC_status_packet;
+
+#define GC_BTN_A        0x01  // buttons1
+#define GC_BTN_B        0x02
+#define GC_BTN_X        0x04
+#define GC_BTN_Y        0x08
+#define GC_BTN_START    0x10
+#define GC_BTN_ORIGIN   0x20  // Set until the pad got GC_ORIGIN, after power up and X + Y + Start
+#define GC_BTN_DLEFT    0x01  // buttons2
+#define GC_BTN_DRIGHT   0x02
+#define GC_BTN_DDOWN    0x04
+#define GC_BTN_DUP      0x08
+#define GC_BTN_Z        0x10
+#define GC_BTN_R        0x20
+#define GC_BTN_L        0x40
+
+#define GC_C_THRESHOLD  48    // C-stick travel that presses the N64 C buttons
+
+// What getN64Packet() found on the port
+enum
+{
+  JOYBUS_NONE = 0,
+  JOYBUS_N64,
+  JOYBUS_GAMECUBE
+};
+
+#define N64_GET_STATUS          0x01
+#define JOYBUS_IDENTIFY         0x00
+#define GC_POLL                 0x40      // Followed by the mode and the rumble byte
+#define GC_POLL_MODE            0x03      // 8 bit sticks and triggers
+#define GC_ORIGIN               0x41      // Rest position, clears GC_BTN_ORIGIN
+#define GC_ORIGIN_REPLY_SIZE    10
+#define JOYBUS_TYPE_GAMECUBE    0x08      // Set in the first identify byte of GameCube devices
+
+// N64 Expansion/Memory Pak commands (raphnet standard)
+#define N64_EXPANSION_WRITE     0x03
+
+#define N64_PAK_BLOCK_SIZE      32
+
+// Rumble Pak addresses (from raphnet implementation), address CRC included
+#define RUMBLEPAK_INIT_ADDRESS  0x8001    // Initialization address
+#define RUMBLEPAK_CTRL_ADDRESS  0xC01B    // Control address for rumble on/off
+
+#define RUMBLE_QUEUE_SIZE       4         // Power of 2
+
 class N64Controller 
 {
   public:  
     N64Controller();
     void N64_init();
-    void translate_N64_data();
     void N64_get_data_from_controller();
-    void N64_send_data_request(unsigned char *buffer, char length);
+    uint8_t N64_send_data_request(unsigned char *buffer, char length, unsigned char *reply, uint8_t replyLength);
     void print_N64_status();
     void getN64Packet();
     N64_status_packet N64_status;
+    uint8_t replyBits; // Bits of the last status reply, 32 when complete (64 for GameCube)
+
+    // A GameCube pad is identified on connect and polled instead. N64_status
+    // then carries its A, B, Z, Start, D-pad, L, R and main stick as N64
+    // buttons, the C-stick as C buttons, GC_status has everything.
+    uint8_t controllerType;
+    GC_status_packet GC_status;
+
+    // Rumble Pak. setRumble() only queues the change, serviceRumble() does
+    // at most one Joybus write per call so it fits between two polls
+    void setRumble(bool enable);
+    bool serviceRumble(); // true if it wrote to the Rumble Pak
+
+    static uint8_t pakDataCrc(const unsigned char *data);     // CRC of a 32 byte block, poly 0x85
 
   private:
-    char N64_raw_dump[33]; // 1 received bit per byte
+    void identify();
+    void getGCPacket();
+    bool getGCOrigin();
+    void gcToN64();
+
+    GC_status_packet GC_origin;
+    bool GC_originValid;
+    bool GC_rumble;
+
+    bool writeMemoryPak(unsigned short address, unsigned char fill);
+
+    uint8_t rumbleQueue[RUMBLE_QUEUE_SIZE];
+    uint8_t rumbleHead;
+    uint8_t rumbleTail;
+    bool rumbleQueued;    // State of the newest queued command
+    bool rumblePakReady;  // Initialized since the controller was connected
+    bool rumblePakFailed; // Initialization failed, no retry until the controller is identified again
 };
 
 #endif
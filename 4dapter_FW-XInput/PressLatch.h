@@ -0,0 +1,63 @@
+/*  PressLatch.h
+ *
+ *  Keeps a press that starts and ends between two reports. Every scan is
+ *  ORed into the latched state and a latched press only goes away once a
+ *  report carrying it was collected by the host, so a tap shorter than the
+ *  report interval still shows up for one report. Unchanged reports are
+ *  not sent again, so the last report sent stands for all of them: once it
+ *  was collected, a released button goes with the next scan.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// 'true' keeps a press in the reports until the host collected one with it,
+// so a tap between two reports isn't lost. 'false' reports the buttons
+// exactly as scanned.
+#ifndef PRESS_LATCH
+#define PRESS_LATCH false
+#endif
+
+class PressLatch
+{
+  public:
+    PressLatch(void) : _latched(0), _sent(0) {}
+
+    // Adds a scan, returns the state to report: the buttons held now plus
+    // the presses no delivered report carried yet
+    uint32_t sample(uint32_t pressed)
+    {
+      _latched |= pressed;
+      return _latched;
+    }
+
+    // A report built from the last sample() went to the endpoint
+    void sent(void) { _sent = _latched; }
+
+    // The host collected the reports sent so far, their presses are done.
+    // Call whenever nothing is pending: the host keeps the last report and
+    // the buttons still held come back with the next sample().
+    void delivered(void) { _latched &= ~_sent; }
+
+  private:
+    uint32_t _latched;
+    uint32_t _sent;     // Presses in the last report sent
+};
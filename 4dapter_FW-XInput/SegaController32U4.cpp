@@ -88,6 +88,23 @@ static void doSwapbuttons(word *state, int btn_1, int btn_2) {
 
 
 word SegaController32U4::updateState()
+{
+  toggleSelect();
+
+  // Short delay to stabilise outputs in controller
+  delayMicroseconds(SC_CYCLE_DELAY);
+
+  return readState();
+}
+
+void SegaController32U4::toggleSelect()
+{
+  // Set the select pin low/high
+  _pinSelect = !_pinSelect;
+  (!_pinSelect) ? PORT_SELECT &= ~MASK_SELECT : PORT_SELECT |= MASK_SELECT; // Set LOW on even cycle, HIGH on uneven cycle
+}
+
+word SegaController32U4::readState()
 {
   // "Normal" Six button controller reading routine, done a bit differently in this project
   // Cycle  TH out  TR in  TL in  D3 in  D2 in  D1 in  D0 in
@@ -100,13 +117,6 @@ word SegaController32U4::updateState()
   // 6      LO      ---    ---    ---    ---    ---    Home    (Home only for 8bitdo wireless gamepads)      
   // 7      HI      ---    ---    ---    ---    ---    ---    
 
-  // Set the select pin low/high
-  _pinSelect = !_pinSelect;
-  (!_pinSelect) ? PORT_SELECT &= ~MASK_SELECT : PORT_SELECT |= MASK_SELECT; // Set LOW on even cycle, HIGH on uneven cycle
-
-  // Short delay to stabilise outputs in controller
-  delayMicroseconds(SC_CYCLE_DELAY);
-
   // Read input register(s)
   _inputReg1 = PINF;
   _inputReg2 = PINB;
@@ -185,6 +195,12 @@ word SegaController32U4::updateState()
   return _currentState;
 }
 
+boolean SegaController32U4::inputActive()
+{
+  return (PINF & B00110000) != B00110000 || (PINB & B00001010) != B00001010 ||
+         (PINC & B01000000) != B01000000 || (PIND & B10000000) != B10000000;
+}
+
 word SegaController32U4::getFinalState() {
 #ifdef DEBUG
   if ((_previousState == SC_BTN_HOME) && (_currentState == (SC_BTN_HOME | SC_BTN_C))) {
@@ -78,6 +78,19 @@ class SegaController32U4
     word updateState(void);
     word getFinalState(void);
 
+    // A Mega Drive pad answered the last read (SMS/Atari pads don't)
+    boolean connected(void) { return _connected; }
+
+    // Any of the lines held low between reads (select high): a button on an
+    // SMS/Atari pad, or up/down/left/right/B/C on a Mega Drive pad. Only
+    // reads the pins, so it can be checked every pass.
+    boolean inputActive(void);
+
+    // updateState() in two halves, so the SC_CYCLE_DELAY settle time can be
+    // spent elsewhere. readState() must not follow before that time is up.
+    void toggleSelect(void);
+    word readState(void);
+
   private:
     // Should A and B and X and Y be swapped?
     void toggleMisterMode(void);
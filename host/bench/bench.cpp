@@ -0,0 +1,229 @@
+/*  bench.cpp
+ *
+ *  Decoding benchmarks of the controller drivers against the simulated pads.
+ *  For every driver it reports the AVR cycles one scan takes on the
+ *  simulated clock (bus timing included) and how many scans per second the
+ *  host manages, which tracks the decode and mapping work itself.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <Arduino.h>
+
+#include "Board.h"
+
+#include "NESSNES_Scanner.h"
+#include "SegaController32U4.h"
+#include "N64_Controller.h"
+#include "NESController.h"
+#include "SNESController.h"
+
+#define SCANS 20000
+
+static Board board;
+
+static NESSNESScanner scanner;
+static SegaController32U4 *genesis;
+static N64Controller n64;
+static NESController nes;
+static SNESController snes;
+
+static uint32_t controllerData[2][2];
+static volatile uint32_t sink;
+
+static uint32_t randomState = 0x4DA97E12;
+
+static uint32_t random32()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static double hostSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// New random pad states between scans, outside of the measurement
+static void randomizePads()
+{
+  uint32_t r = random32();
+
+  board.nes.setPressed(r & 0xFF);
+  board.powerPadD3.setPressed((r >> 8) & 0xFF);
+  board.snes.setPressed((r >> 16) & 0x0FFF);
+  board.genesis.setPressed(random32() & 0x0FFF);
+  board.n64.setState(r, (r >> 8) & ~0x40, r >> 16, r >> 24); // Bit 6 of the second byte is always 0
+}
+
+static void randomizeGameCube()
+{
+  randomizePads();
+
+  uint32_t r = random32();
+  board.n64.setGameCubeState(r & 0x1F, (r >> 8) & 0x7F, r >> 16, r >> 24, r, r >> 8, r >> 16, r >> 24);
+}
+
+static void randomizeNtt()
+{
+  randomizePads();
+  board.snes.setPressed((random32() & 0xBFFF0FFF) | (1UL << 13));
+}
+
+static void scanNesSnes()
+{
+  scanner.scan(controllerData);
+  sink = controllerData[NES][BUTTONS] ^ controllerData[SNES][BUTTONS];
+}
+
+static void scanGenesis()
+{
+  for(uint8_t cycle = 0; cycle < 8; cycle++)
+    genesis->updateState();
+
+  sink = genesis->getFinalState();
+}
+
+static void scanN64()
+{
+  n64.getN64Packet();
+  sink = n64.N64_status.data1;
+}
+
+// The scan section of the HID loop, NES/SNES clocked in the Genesis settle time
+static void scanHidPass()
+{
+  scanner.begin();
+
+  for(uint8_t cycle = 0; cycle < 8; cycle++)
+  {
+    genesis->toggleSelect();
+    scanner.stepFor(SC_CYCLE_DELAY);
+
+    genesis->readState();
+  }
+
+  while(scanner.step());
+  scanner.finish(controllerData);
+
+  sink = genesis->getFinalState();
+  scanN64();
+}
+
+static void scanNoN64Nes()
+{
+  sink = nes.readController().standardButtons;
+}
+
+static void scanNoN64Snes()
+{
+  sink = snes.readController().standardButtons;
+}
+
+static void run(const char *name, void (*scan)(), void (*randomize)())
+{
+  uint64_t cycles = 0;
+  double hostTime = 0;
+
+  for(uint32_t i = 0; i < SCANS; i++)
+  {
+    randomize();
+
+    // 6 button pads need their idle time between reads
+    delayMicroseconds(SC_RESET_DELAY);
+
+    uint64_t startCycles = Sim::cycles;
+    double start = hostSeconds();
+
+    scan();
+
+    hostTime += hostSeconds() - start;
+    cycles += Sim::cycles - startCycles;
+  }
+
+  double cyclesPerScan = (double)cycles / SCANS;
+
+  printf("%-22s %10.0f %9.1f %12.0f %14.0f\n", name,
+         cyclesPerScan,
+         cyclesPerScan / SIM_CYCLES_PER_US,
+         (double)F_CPU / cyclesPerScan,
+         SCANS / hostTime);
+}
+
+int main()
+{
+  board.reset();
+
+  genesis = new SegaController32U4(0);
+  n64.N64_init();
+  nes.init();
+  snes.init();
+
+#if (N64_JOYBUS_TIMER1 == true)
+  printf("N64 Joybus: Timer1 driver\n\n");
+#else
+  printf("N64 Joybus: cycle counted driver\n\n");
+#endif
+
+  printf("%-22s %10s %9s %12s %14s\n", "driver", "cycles", "us", "avr scans/s", "host scans/s");
+
+  run("NES/SNES scanner", scanNesSnes, randomizePads);
+  run("NES/SNES scanner NTT", scanNesSnes, randomizeNtt);
+  run("Genesis 6 button", scanGenesis, randomizePads);
+  run("N64 status", scanN64, randomizePads);
+  run("HID pass", scanHidPass, randomizePads);
+
+  // Same port, a GameCube pad plugged in: the first poll goes unanswered
+  // and the next one identifies it
+  board.n64.setGameCube(true);
+  scanN64();
+  scanN64();
+  run("GameCube poll", scanN64, randomizeGameCube);
+  run("HID pass GameCube", scanHidPass, randomizeGameCube);
+  board.n64.setGameCube(false);
+  scanN64();
+
+  run("noN64 NES", scanNoN64Nes, randomizePads);
+  run("noN64 SNES", scanNoN64Snes, randomizePads);
+
+  // Latch and clock pulses shortened to what the pads keep up with
+  scanner.calibrate();
+  run("NES/SNES calibrated", scanNesSnes, randomizePads);
+  run("HID pass calibrated", scanHidPass, randomizePads);
+  scanner = NESSNESScanner();
+
+  // What the presence back-off saves on each pass with the ports empty
+  board.n64.setConnected(false);
+  board.nes.setConnected(false);
+  board.snes.setConnected(false);
+  board.powerPadD3.setConnected(false);
+  board.powerPadD4.setConnected(false);
+  board.genesis.setConnected(false);
+  run("N64 empty port", scanN64, randomizePads);
+  run("HID pass empty ports", scanHidPass, randomizePads);
+
+  delete genesis;
+  return 0;
+}
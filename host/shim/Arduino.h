@@ -0,0 +1,84 @@
+/*  Arduino.h (host shim)
+ *
+ *  The part of the Arduino AVR core the controller drivers use, timing runs
+ *  on the simulated clock. Types keep their AVR widths where the drivers
+ *  depend on them (word is 16 bit).
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "binary.h"
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH          0x1
+#define LOW           0x0
+
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+#define A0  18
+#define A1  19
+#define A2  20
+#define A3  21
+#define A4  22
+#define A5  23
+
+#define bitRead(value, bit)  (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)   ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#define interrupts()   sei()
+#define noInterrupts() cli()
+
+// Cycle exact busy wait of avr-gcc
+#define __builtin_avr_delay_cycles(n) Sim::advance(n)
+
+typedef bool     boolean;
+typedef uint8_t  byte;
+typedef uint16_t word;
+
+// Functions instead of the core's macros, those would break the C++ headers
+template<typename T, typename U> static inline T min(T a, U b) { return (a < (T)b) ? a : (T)b; }
+template<typename T, typename U> static inline T max(T a, U b) { return (a > (T)b) ? a : (T)b; }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+unsigned long micros(void);
+unsigned long millis(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+#endif
@@ -0,0 +1,41 @@
+/*  EEPROM.h (host shim)
+ *
+ *  The 1KB EEPROM of the ATmega32U4 in RAM, erased (0xFF) at start.
+ */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define SIM_EEPROM_SIZE 1024
+
+class EEPROMClass
+{
+  public:
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+
+    uint8_t read(int index) { return data[index]; }
+    void write(int index, uint8_t value) { data[index] = value; }
+    void update(int index, uint8_t value) { data[index] = value; }
+    uint16_t length() { return SIM_EEPROM_SIZE; }
+
+    template<typename T> T &get(int index, T &t)
+    {
+      memcpy(&t, &data[index], sizeof(T));
+      return t;
+    }
+
+    template<typename T> const T &put(int index, const T &t)
+    {
+      memcpy(&data[index], &t, sizeof(T));
+      return t;
+    }
+
+    uint8_t data[SIM_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,11 @@
+/*  avr/eeprom.h (host shim)
+ *
+ *  EEPROM writes finish at once on the host.
+ */
+
+#ifndef _AVR_EEPROM_H_
+#define _AVR_EEPROM_H_
+
+#define eeprom_is_ready() (1)
+
+#endif
@@ -0,0 +1,15 @@
+/*  avr/interrupt.h (host shim)
+ *
+ *  The global interrupt flag only lives in SREG, nothing ever interrupts the
+ *  simulated code.
+ */
+
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define cli() (SREG &= ~_BV(SREG_I))
+#define sei() (SREG |= _BV(SREG_I))
+
+#endif
@@ -0,0 +1,151 @@
+/*  avr/io.h (host shim)
+ *
+ *  The ATmega32U4 registers the drivers use, as objects that go through the
+ *  simulation in sim/Sim.h. Every access costs the AVR cycles of the
+ *  matching instruction (in/out 1, sbi/cbi 2) so polling loops and timeouts
+ *  advance time like on the chip.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+#include "Sim.h"
+
+#define _BV(bit) (1 << (bit))
+
+enum
+{
+  SIM_REG_PIN = 0,
+  SIM_REG_PORT,
+  SIM_REG_DDR
+};
+
+// PINx, PORTx and DDRx. Writes take int like the AVR's int promoted
+// expressions do, so '&= ~B00000011' truncates without a warning
+class SimPortReg
+{
+  public:
+    SimPortReg(uint8_t port, uint8_t kind) : _port(port), _kind(kind) {}
+
+    operator uint8_t() const
+    {
+      Sim::advance(1);
+      return get();
+    }
+
+    SimPortReg &operator=(int value)
+    {
+      Sim::advance(1);
+      set(value);
+      return *this;
+    }
+
+    SimPortReg &operator|=(int value)
+    {
+      Sim::advance(2);
+      set(get() | value);
+      return *this;
+    }
+
+    SimPortReg &operator&=(int value)
+    {
+      Sim::advance(2);
+      set(get() & value);
+      return *this;
+    }
+
+    SimPortReg &operator^=(int value)
+    {
+      Sim::advance(2);
+      set(get() ^ value);
+      return *this;
+    }
+
+  private:
+    uint8_t get() const
+    {
+      if(_kind == SIM_REG_PIN)  return Sim::readPin(_port);
+      if(_kind == SIM_REG_PORT) return Sim::readPort(_port);
+      return Sim::readDdr(_port);
+    }
+
+    void set(uint8_t value)
+    {
+      if(_kind == SIM_REG_PORT)
+        Sim::writePort(_port, value);
+      else if(_kind == SIM_REG_DDR)
+        Sim::writeDdr(_port, value);
+      else
+        Sim::writePort(_port, Sim::readPort(_port) ^ value); // Writing PINx toggles PORTx
+    }
+
+    uint8_t _port;
+    uint8_t _kind;
+};
+
+// Registers without side effects in the simulation (SREG, timer control)
+class SimReg
+{
+  public:
+    SimReg() : value(0) {}
+
+    operator uint8_t() const { Sim::advance(1); return value; }
+    SimReg &operator=(int v) { Sim::advance(1); value = v; return *this; }
+    SimReg &operator|=(int v) { Sim::advance(2); value |= v; return *this; }
+    SimReg &operator&=(int v) { Sim::advance(2); value &= v; return *this; }
+
+    uint8_t value;
+};
+
+// TCNT1, free running at clk/1 from reset
+class SimTimer16
+{
+  public:
+    operator uint16_t() const { Sim::advance(2); return (uint16_t)Sim::cycles; }
+};
+
+class SimTimer8Low
+{
+  public:
+    operator uint8_t() const { Sim::advance(1); return (uint8_t)Sim::cycles; }
+};
+
+extern SimPortReg PINB, PORTB, DDRB;
+extern SimPortReg PINC, PORTC, DDRC;
+extern SimPortReg PIND, PORTD, DDRD;
+extern SimPortReg PINE, PORTE, DDRE;
+extern SimPortReg PINF, PORTF, DDRF;
+
+extern SimReg SREG;
+extern SimReg TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern SimTimer16 TCNT1;
+extern SimTimer8Low TCNT1L;
+
+#define SREG_I  7
+
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define TOIE1   0
+#define TOV1    0
+
+#endif
@@ -0,0 +1,22 @@
+/*  avr/pgmspace.h (host shim)
+ *
+ *  Flash and RAM share one address space on the host.
+ */
+
+#ifndef __PGMSPACE_H_
+#define __PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#endif
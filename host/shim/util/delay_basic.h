@@ -0,0 +1,23 @@
+/*  util/delay_basic.h (host shim)
+ *
+ *  Busy loops of avr-libc, 3 and 4 cycles per iteration, 0 runs 256/65536 times.
+ */
+
+#ifndef _UTIL_DELAY_BASIC_H_
+#define _UTIL_DELAY_BASIC_H_
+
+#include <stdint.h>
+
+#include "Sim.h"
+
+static inline void _delay_loop_1(uint8_t count)
+{
+  Sim::advance(3UL * (count ? count : 256));
+}
+
+static inline void _delay_loop_2(uint16_t count)
+{
+  Sim::advance(4UL * (count ? count : 65536));
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*  Board.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <Arduino.h>
+
+#include "Board.h"
+
+Board::Board()
+  : nes(SIM_PORTF, B10000000, 8),
+    powerPadD3(SIM_PORTB, B00010000, 8),
+    powerPadD4(SIM_PORTB, B00100000, 8),
+    snes(SIM_PORTF, B01000000, 32),
+    nttD2(SIM_PORTD, B00000100, 32)
+{
+}
+
+void Board::reset()
+{
+  Sim::reset();
+
+  nes.setPressed(0);
+  powerPadD3.setPressed(0);
+  powerPadD4.setPressed(0);
+  snes.setPressed(0);
+  snes.setLength(32);
+  nttD2.setPressed(0);
+  nes.setConnected(true);
+  powerPadD3.setConnected(true);
+  powerPadD4.setConnected(true);
+  snes.setConnected(true);
+  nes.setMinPulse(0);
+  powerPadD3.setMinPulse(0);
+  powerPadD4.setMinPulse(0);
+  snes.setMinPulse(0);
+  nttD2.setMinPulse(0);
+  genesis.setPressed(0);
+  genesis.setConnected(true);
+  genesis.setSixButton(true);
+  n64.setState(0, 0, 0, 0);
+  n64.setConnected(true);
+  n64.setPak(PAK_NONE);
+  n64.setGameCube(false);
+
+  Sim::attach(&nes);
+  Sim::attach(&powerPadD3);
+  Sim::attach(&powerPadD4);
+  Sim::attach(&snes);
+  Sim::attach(&nttD2);
+  Sim::attach(&genesis);
+  Sim::attach(&n64);
+
+  // NES / SNES latch and clock (PD1/PD0) low, data lines pulled up
+  DDRD  |=  B00000011;
+  PORTD &= ~B00000011;
+  DDRF  &= ~B11000000;
+  PORTF |=  B11000000;
+  DDRB  &= ~B00110000;
+  PORTB |=  B00110000;
+
+  // DB9 pin 5 power
+  DDRB  |= B00000100;
+  PORTB |= B00000100;
+}
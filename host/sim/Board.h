@@ -0,0 +1,49 @@
+/*  Board.h
+ *
+ *  The 4dapter with a pad on every port: NES pad and Power Pad, SNES/NTT pad
+ *  (plus the noN64 NTT line on PD2), Genesis pad and N64 controller. reset()
+ *  sets the ports up like the firmware's setup() does.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef Board_h
+#define Board_h
+
+#include "ShiftRegisterPad.h"
+#include "GenesisPad.h"
+#include "JoybusController.h"
+
+class Board
+{
+  public:
+    Board();
+
+    // Restarts the simulation with all pads released and attached
+    void reset();
+
+    ShiftRegisterPad nes;         // PF7
+    ShiftRegisterPad powerPadD3;  // PB4
+    ShiftRegisterPad powerPadD4;  // PB5
+    ShiftRegisterPad snes;        // PF6, 32 bits to cover the NTT
+    ShiftRegisterPad nttD2;       // PD2
+    GenesisPad       genesis;
+    JoybusController n64;
+};
+
+#endif
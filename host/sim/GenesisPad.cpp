@@ -0,0 +1,131 @@
+/*  GenesisPad.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GenesisPad.h"
+
+#define SELECT_BIT 6 // PE6
+
+enum
+{
+  DB9_1 = 0x01,
+  DB9_2 = 0x02,
+  DB9_3 = 0x04,
+  DB9_4 = 0x08,
+  DB9_6 = 0x10,
+  DB9_9 = 0x20
+};
+
+GenesisPad::GenesisPad(bool sixButton)
+  : _sixButton(sixButton)
+{
+  _connected = true;
+  _pressed = 0;
+  reset();
+}
+
+void GenesisPad::reset()
+{
+  _select = true;
+  _lowPulses = 0;
+  _lastEdge = 0;
+}
+
+void GenesisPad::outputsChanged()
+{
+  bool select = Sim::outputLevel(SIM_PORTE, SELECT_BIT);
+  if(select == _select)
+    return;
+
+  if(Sim::cycles - _lastEdge > GENESIS_RESET_CYCLES)
+    _lowPulses = 0;
+
+  if(!select)
+    _lowPulses = (_lowPulses % 4) + 1;
+
+  _select = select;
+  _lastEdge = Sim::cycles;
+}
+
+uint8_t GenesisPad::lines()
+{
+  uint8_t low = 0;
+  bool extra = _sixButton && Sim::cycles - _lastEdge <= GENESIS_RESET_CYCLES;
+
+  if(_select)
+  {
+    if(extra && _lowPulses == 3)
+    {
+      if(_pressed & GEN_Z)    low |= DB9_1;
+      if(_pressed & GEN_Y)    low |= DB9_2;
+      if(_pressed & GEN_X)    low |= DB9_3;
+      if(_pressed & GEN_MODE) low |= DB9_4;
+    }
+    else
+    {
+      if(_pressed & GEN_UP)    low |= DB9_1;
+      if(_pressed & GEN_DOWN)  low |= DB9_2;
+      if(_pressed & GEN_LEFT)  low |= DB9_3;
+      if(_pressed & GEN_RIGHT) low |= DB9_4;
+    }
+
+    if(_pressed & GEN_B) low |= DB9_6;
+    if(_pressed & GEN_C) low |= DB9_9;
+  }
+  else
+  {
+    if(extra && _lowPulses == 3)
+    {
+      low |= DB9_1 | DB9_2 | DB9_3 | DB9_4; // Six button ID
+    }
+    else if(extra && _lowPulses == 4)
+    {
+      if(_pressed & GEN_HOME) low |= DB9_1;
+    }
+    else
+    {
+      if(_pressed & GEN_UP)   low |= DB9_1;
+      if(_pressed & GEN_DOWN) low |= DB9_2;
+      low |= DB9_3 | DB9_4; // Mega Drive pad ID
+    }
+
+    if(_pressed & GEN_A)     low |= DB9_6;
+    if(_pressed & GEN_START) low |= DB9_9;
+  }
+
+  return low;
+}
+
+uint8_t GenesisPad::pullsLow(uint8_t port)
+{
+  if(!_connected)
+    return 0;
+
+  uint8_t low = lines();
+
+  switch(port)
+  {
+    case SIM_PORTC: return (low & DB9_1) ? 0x40 : 0;                                  // PC6
+    case SIM_PORTD: return (low & DB9_2) ? 0x80 : 0;                                  // PD7
+    case SIM_PORTF: return ((low & DB9_3) ? 0x20 : 0) | ((low & DB9_4) ? 0x10 : 0);   // PF5, PF4
+    case SIM_PORTB: return ((low & DB9_6) ? 0x08 : 0) | ((low & DB9_9) ? 0x02 : 0);   // PB3, PB1
+  }
+
+  return 0;
+}
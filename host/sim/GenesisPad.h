@@ -0,0 +1,75 @@
+/*  GenesisPad.h
+ *
+ *  A Mega Drive/Genesis pad on the DB9 port, select (TH) on PE6. The 3 button
+ *  pad only switches its multiplexer with select, the 6 button pad also counts
+ *  the select pulses and answers the extra cycles (see the table in
+ *  SegaController32U4.cpp) until select stays put for 1.5ms.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GenesisPad_h
+#define GenesisPad_h
+
+#include "Sim.h"
+
+enum
+{
+  GEN_UP    = 0x0001,
+  GEN_DOWN  = 0x0002,
+  GEN_LEFT  = 0x0004,
+  GEN_RIGHT = 0x0008,
+  GEN_A     = 0x0010,
+  GEN_B     = 0x0020,
+  GEN_C     = 0x0040,
+  GEN_START = 0x0080,
+  GEN_X     = 0x0100,
+  GEN_Y     = 0x0200,
+  GEN_Z     = 0x0400,
+  GEN_MODE  = 0x0800,
+  GEN_HOME  = 0x1000  // 8bitdo receivers only
+};
+
+#define GENESIS_RESET_CYCLES (1500UL * SIM_CYCLES_PER_US)
+
+class GenesisPad : public SimDevice
+{
+  public:
+    GenesisPad(bool sixButton = true);
+
+    void setPressed(uint16_t pressed) { _pressed = pressed; }
+    void setConnected(bool connected) { _connected = connected; }
+    void setSixButton(bool sixButton) { _sixButton = sixButton; }
+
+    virtual void reset();
+    virtual void outputsChanged();
+    virtual uint8_t pullsLow(uint8_t port);
+
+  private:
+    // DB9 pins 1, 2, 3, 4, 6, 9 as one bit each, set = low
+    uint8_t lines();
+
+    bool     _sixButton;
+    bool     _connected;
+    uint16_t _pressed;
+    bool     _select;
+    uint8_t  _lowPulses;  // Select low pulses since the counter reset, 1-4
+    uint64_t _lastEdge;
+};
+
+#endif
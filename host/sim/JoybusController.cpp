@@ -0,0 +1,339 @@
+/*  JoybusController.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include "JoybusController.h"
+
+#define LINE_BIT        6     // PB6
+#define BIT_CYCLES      64    // 4us
+#define ONE_LOW         16    // 1us
+#define ZERO_LOW        48    // 3us
+#define STOP_LOW        32    // 2us
+#define BIT_THRESHOLD   32    // Console bits shorter than 2us low are a 1
+#define REPLY_DELAY     32    // 2us from the console stop bit to the reply
+#define IDLE_RESET      1600  // 100us without a bit drops a partial command
+
+enum
+{
+  CMD_INFO    = 0x00,
+  CMD_STATUS  = 0x01,
+  CMD_READ    = 0x02,
+  CMD_WRITE   = 0x03,
+  CMD_GC_POLL = 0x40,
+  CMD_GC_ORIGIN = 0x41,
+  CMD_RESET   = 0xFF
+};
+
+// Command length in bytes, the stop bit follows
+static uint8_t commandLength(uint8_t command)
+{
+  switch(command)
+  {
+    case CMD_READ:
+    case CMD_GC_POLL: return 3;
+    case CMD_WRITE:   return 35;
+  }
+
+  return 1;
+}
+
+JoybusController::JoybusController()
+{
+  commands = 0;
+  lastCommand = 0;
+  lastAddress = 0;
+  pakWrites = 0;
+  addressCrcErrors = 0;
+
+  _connected = true;
+  _gameCube = false;
+  _gameCubeRumble = false;
+  memset(_gameCubeStatus, 0, sizeof(_gameCubeStatus));
+  _gameCubeStatus[1] = 0x80;
+  memset(_gameCubeOrigin, 0, sizeof(_gameCubeOrigin));
+  _gameCubeOriginPending = false;
+  _pak = PAK_NONE;
+  _rumble = false;
+  _rumbleProbe = 0;
+  memset(_status, 0, sizeof(_status));
+  memset(_memory, 0, sizeof(_memory));
+
+  reset();
+}
+
+void JoybusController::reset()
+{
+  _line = true;
+  _fall = 0;
+  _lastRise = 0;
+  _rxBits = 0;
+  _txBits = 0;
+  _txStart = 0;
+  _truncateBits = 0;
+  _truncateCount = 0;
+}
+
+void JoybusController::setState(uint8_t buttons1, uint8_t buttons2, int8_t x, int8_t y)
+{
+  _status[0] = buttons1;
+  _status[1] = buttons2;
+  _status[2] = (uint8_t)x;
+  _status[3] = (uint8_t)y;
+}
+
+void JoybusController::setGameCube(bool gameCube)
+{
+  // Powered up, the origin is where everything rests now
+  if(gameCube && !_gameCube)
+    resetGameCubeOrigin();
+
+  _gameCube = gameCube;
+}
+
+void JoybusController::resetGameCubeOrigin()
+{
+  memcpy(_gameCubeOrigin, _gameCubeStatus, sizeof(_gameCubeStatus));
+  _gameCubeOrigin[0] = 0x00;
+  _gameCubeOrigin[1] = 0x80;
+  _gameCubeOriginPending = true;
+}
+
+void JoybusController::setGameCubeState(uint8_t buttons1, uint8_t buttons2, uint8_t x, uint8_t y,
+                                        uint8_t cx, uint8_t cy, uint8_t l, uint8_t r)
+{
+  _gameCubeStatus[0] = buttons1;
+  _gameCubeStatus[1] = buttons2 | 0x80;
+  _gameCubeStatus[2] = x;
+  _gameCubeStatus[3] = y;
+  _gameCubeStatus[4] = cx;
+  _gameCubeStatus[5] = cy;
+  _gameCubeStatus[6] = l;
+  _gameCubeStatus[7] = r;
+}
+
+uint8_t JoybusController::addressCrc(uint16_t address)
+{
+  static const uint8_t xorTable[11] = { 0x15, 0x1F, 0x0B, 0x16, 0x19, 0x07, 0x0E, 0x1C, 0x0D, 0x1A, 0x01 };
+  uint8_t crc = 0;
+
+  for(uint8_t bit = 5; bit < 16; bit++)
+  {
+    if(address & (1U << bit))
+      crc ^= xorTable[bit - 5];
+  }
+
+  return crc;
+}
+
+uint8_t JoybusController::dataCrc(const uint8_t *data)
+{
+  uint8_t crc = 0;
+
+  for(uint8_t i = 0; i <= 32; i++)
+  {
+    for(int8_t bit = 7; bit >= 0; bit--)
+    {
+      uint8_t xorValue = (crc & 0x80) ? 0x85 : 0x00;
+      crc <<= 1;
+      if(i < 32 && (data[i] & (1 << bit)))
+        crc |= 1;
+      crc ^= xorValue;
+    }
+  }
+
+  return crc;
+}
+
+void JoybusController::outputsChanged()
+{
+  bool line = Sim::outputLevel(SIM_PORTB, LINE_BIT);
+  if(line == _line)
+    return;
+
+  _line = line;
+
+  if(!line)
+  {
+    // The console talking ends any reply
+    _txBits = 0;
+
+    if(Sim::cycles - _lastRise > IDLE_RESET)
+      _rxBits = 0;
+
+    _fall = Sim::cycles;
+    return;
+  }
+
+  uint64_t width = Sim::cycles - _fall;
+  _lastRise = Sim::cycles;
+
+  if(width >= BIT_CYCLES)
+  {
+    _rxBits = 0;
+    return;
+  }
+
+  uint8_t index = _rxBits / 8;
+  uint8_t mask = 0x80 >> (_rxBits % 8);
+
+  if(mask == 0x80)
+    _rx[index] = 0;
+  if(width < BIT_THRESHOLD)
+    _rx[index] |= mask;
+
+  _rxBits++;
+
+  if(_rxBits == commandLength(_rx[0]) * 8 + 1)
+  {
+    received();
+    _rxBits = 0;
+  }
+}
+
+void JoybusController::received()
+{
+  commands++;
+  lastCommand = _rx[0];
+
+  if(!_connected)
+    return;
+
+  uint8_t block[33];
+
+  if(_gameCube)
+  {
+    if(_rx[0] == CMD_INFO || _rx[0] == CMD_RESET)
+    {
+      block[0] = 0x09;
+      block[1] = 0x00;
+      block[2] = 0x03;
+      reply(block, 3);
+    }
+    else if(_rx[0] == CMD_GC_POLL)
+    {
+      _gameCubeRumble = _rx[2] & 0x01;
+      memcpy(block, _gameCubeStatus, 8);
+      if(_gameCubeOriginPending)
+        block[0] |= 0x20;
+      reply(block, 8);
+    }
+    else if(_rx[0] == CMD_GC_ORIGIN)
+    {
+      _gameCubeOriginPending = false;
+      reply(_gameCubeOrigin, 10);
+    }
+    return;
+  }
+
+  switch(_rx[0])
+  {
+    case CMD_INFO:
+    case CMD_RESET:
+      block[0] = 0x05;
+      block[1] = 0x00;
+      block[2] = (_pak != PAK_NONE) ? 0x01 : 0x02;
+      reply(block, 3);
+      break;
+
+    case CMD_STATUS:
+      reply(_status, 4);
+      break;
+
+    case CMD_READ:
+    case CMD_WRITE:
+    {
+      uint16_t field = (uint16_t)_rx[1] << 8 | _rx[2];
+      uint16_t address = field & 0xFFE0;
+      bool valid = (field & 0x1F) == addressCrc(address);
+
+      lastAddress = field;
+      if(!valid)
+        addressCrcErrors++;
+
+      if(_rx[0] == CMD_READ)
+      {
+        memset(block, 0, 32);
+
+        if(valid && _pak == PAK_MEMORY && address < JOYBUS_PAK_SIZE)
+          memcpy(block, &_memory[address], 32);
+        else if(valid && _pak == PAK_RUMBLE && (address & 0xF000) == 0x8000)
+          memset(block, (_rumbleProbe == 0x80) ? 0x80 : 0x00, 32);
+      }
+      else
+      {
+        memcpy(block, &_rx[3], 32);
+        pakWrites++;
+
+        if(valid && _pak == PAK_MEMORY && address < JOYBUS_PAK_SIZE)
+          memcpy(&_memory[address], block, 32);
+        else if(valid && _pak == PAK_RUMBLE && (address & 0xF000) == 0x8000)
+          _rumbleProbe = block[31];
+        else if(valid && _pak == PAK_RUMBLE && (address & 0xF000) == 0xC000)
+          _rumble = block[31] & 0x01;
+      }
+
+      // Without a pak the controller answers with an inverted CRC
+      block[32] = dataCrc(block) ^ ((_pak == PAK_NONE) ? 0xFF : 0x00);
+
+      if(_rx[0] == CMD_READ)
+        reply(block, 33);
+      else
+        reply(&block[32], 1);
+      break;
+    }
+  }
+}
+
+void JoybusController::reply(const uint8_t *data, uint8_t length)
+{
+  memcpy(_tx, data, length);
+  _txBits = length * 8;
+  _txStart = Sim::cycles + REPLY_DELAY;
+
+  if(_truncateCount != 0)
+  {
+    _truncateCount--;
+    if(_txBits > _truncateBits)
+      _txBits = _truncateBits;
+  }
+}
+
+uint8_t JoybusController::pullsLow(uint8_t port)
+{
+  if(port != SIM_PORTB || _txBits == 0 || Sim::cycles < _txStart)
+    return 0;
+
+  uint64_t t = Sim::cycles - _txStart;
+  uint64_t bit = t / BIT_CYCLES;
+  uint8_t phase = t % BIT_CYCLES;
+
+  if(bit < _txBits)
+  {
+    bool one = _tx[bit / 8] & (0x80 >> (bit % 8));
+    return (phase < (one ? ONE_LOW : ZERO_LOW)) ? (1 << LINE_BIT) : 0;
+  }
+
+  if(bit == _txBits)
+    return (phase < STOP_LOW) ? (1 << LINE_BIT) : 0;
+
+  _txBits = 0;
+  return 0;
+}
@@ -0,0 +1,120 @@
+/*  JoybusController.h
+ *
+ *  An N64 controller on the Joybus line (PB6, open drain). Console bits are
+ *  decoded from their low time as the AVR releases the line, after the stop
+ *  bit the reply is played back on the line with the controller's timing:
+ *  4us bit cells, 1us low for a 1, 3us low for a 0, 2us low stop bit.
+ *  Handles info/reset, status and pak read/write with a Rumble Pak or a
+ *  32KB Controller Pak plugged in.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef JoybusController_h
+#define JoybusController_h
+
+#include "Sim.h"
+
+enum
+{
+  PAK_NONE = 0,
+  PAK_RUMBLE,
+  PAK_MEMORY
+};
+
+#define JOYBUS_PAK_SIZE 0x8000
+
+class JoybusController : public SimDevice
+{
+  public:
+    JoybusController();
+
+    void setConnected(bool connected) { _connected = connected; }
+    // Swapping the pak also stops the motor and forgets the rumble probe
+    void setPak(uint8_t pak) { _pak = pak; _rumble = false; _rumbleProbe = 0; }
+
+    // Status reply: A B Z Start Dup Ddown Dleft Dright, Reset 0 L R Cup Cdown Cleft Cright, X, Y
+    void setState(uint8_t buttons1, uint8_t buttons2, int8_t x, int8_t y);
+
+    // Answers as a GameCube pad instead: identify 0x09, the 0x40 poll and the
+    // 0x41 origin. Poll reply 0 0 Origin Start Y X B A, 1 L R Z Dup Ddown
+    // Dright Dleft, sticks, triggers. The Origin bit is set from power up
+    // until the first 0x41.
+    void setGameCube(bool gameCube);
+    void setGameCubeState(uint8_t buttons1, uint8_t buttons2, uint8_t x, uint8_t y,
+                          uint8_t cx, uint8_t cy, uint8_t l, uint8_t r);
+    bool gameCubeRumble() const { return _gameCubeRumble; }
+
+    // Takes the current sticks and triggers as the origin and sets the Origin
+    // bit again, like X + Y + Start held on the pad
+    void resetGameCubeOrigin();
+    bool gameCubeOriginPending() const { return _gameCubeOriginPending; }
+
+    // The next 'count' replies stop after 'bits' bits, like on a bad cable
+    void truncateReplies(uint8_t bits, uint8_t count) { _truncateBits = bits; _truncateCount = count; }
+
+    bool rumble() const { return _rumble; }
+    uint8_t *pakMemory() { return _memory; }
+
+    virtual void reset();
+    virtual void outputsChanged();
+    virtual uint8_t pullsLow(uint8_t port);
+
+    // 5 bit CRC of a pak address (bits 15-5), sent in bits 4-0
+    static uint8_t addressCrc(uint16_t address);
+
+    // CRC of a 32 byte pak block, poly 0x85
+    static uint8_t dataCrc(const uint8_t *data);
+
+    uint32_t commands;          // Complete commands received
+    uint8_t  lastCommand;
+    uint16_t lastAddress;       // Address field of the last pak access, CRC included
+    uint32_t pakWrites;
+    uint32_t addressCrcErrors;
+
+  private:
+    void received();
+    void reply(const uint8_t *data, uint8_t length);
+
+    bool     _connected;
+    bool     _gameCube;
+    bool     _gameCubeRumble;
+    uint8_t  _gameCubeStatus[8];
+    uint8_t  _gameCubeOrigin[10];
+    bool     _gameCubeOriginPending;
+    uint8_t  _pak;
+    uint8_t  _status[4];
+    bool     _rumble;
+    uint8_t  _rumbleProbe;
+    uint8_t  _memory[JOYBUS_PAK_SIZE];
+
+    bool     _line;
+    uint64_t _fall;
+    uint64_t _lastRise;
+    uint8_t  _rx[36];
+    uint16_t _rxBits;
+
+    uint8_t  _tx[33];
+    uint16_t _txBits;
+    uint64_t _txStart;
+
+    uint8_t  _truncateBits;
+    uint8_t  _truncateCount;
+};
+
+#endif
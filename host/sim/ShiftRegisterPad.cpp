@@ -0,0 +1,95 @@
+/*  ShiftRegisterPad.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ShiftRegisterPad.h"
+
+#define LATCH_BIT 1 // PD1
+#define CLOCK_BIT 0 // PD0
+
+ShiftRegisterPad::ShiftRegisterPad(uint8_t port, uint8_t mask, uint8_t length)
+  : _port(port), _mask(mask), _length(length)
+{
+  _pressed = 0;
+  _connected = true;
+  _minPulse = 0;
+  reset();
+}
+
+void ShiftRegisterPad::reset()
+{
+  _shift = 0;
+  _clocks = 0;
+  _clock = false;
+  _latch = false;
+  _latchRise = 0;
+  _clockRise = 0;
+}
+
+void ShiftRegisterPad::outputsChanged()
+{
+  bool latch = Sim::outputLevel(SIM_PORTD, LATCH_BIT);
+  bool clock = Sim::outputLevel(SIM_PORTD, CLOCK_BIT);
+
+  if(latch && !_latch)
+    _latchRise = Sim::cycles;
+  if(clock && !_clock)
+    _clockRise = Sim::cycles;
+
+  if(_minPulse)
+  {
+    if(!latch && _latch && Sim::cycles - _latchRise >= _minPulse)
+      load();
+    else if(!latch && !clock && _clock && Sim::cycles - _clockRise >= _minPulse)
+      shift();
+  }
+  else if(latch)
+  {
+    // Parallel load, the clock has no effect meanwhile
+    load();
+  }
+  else if(clock && !_clock)
+  {
+    shift();
+  }
+
+  _latch = latch;
+  _clock = clock;
+}
+
+void ShiftRegisterPad::load()
+{
+  _shift = (_length < 32) ? (_pressed | (0xFFFFFFFFUL << _length)) : _pressed;
+  _clocks = 0;
+}
+
+void ShiftRegisterPad::shift()
+{
+  _shift >>= 1;
+  if(_clocks < 0xFF)
+    _clocks++;
+}
+
+uint8_t ShiftRegisterPad::pullsLow(uint8_t port)
+{
+  if(port != _port || !_connected)
+    return 0;
+
+  return (_shift & 1) ? _mask : 0;
+}
@@ -0,0 +1,77 @@
+/*  ShiftRegisterPad.h
+ *
+ *  A NES/SNES style pad: a parallel-in shift register loaded while latch
+ *  (PD1) is high and advanced on every rising clock (PD0) edge. It drives one
+ *  data line, so a Power Pad is two of these (D3, D4) and the noN64 NTT wiring
+ *  adds one on PD2. Bits past the length read as released, like the serial
+ *  input of the real shift registers tied high.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ShiftRegisterPad_h
+#define ShiftRegisterPad_h
+
+#include "Sim.h"
+
+class ShiftRegisterPad : public SimDevice
+{
+  public:
+    ShiftRegisterPad(uint8_t port, uint8_t mask, uint8_t length);
+
+    // Bit n set: the line is low (pressed) for the nth bit shifted out. Past
+    // 'length' bits the grounded serial input shifts in pressed bits.
+    void setPressed(uint32_t pressed) { _pressed = pressed; }
+
+    // Register length, e.g. 16 for a standard SNES pad instead of the NTT keypad
+    void setLength(uint8_t length) { _length = length; }
+
+    // Unplugged, the line is left to the pull-up
+    void setConnected(bool connected) { _connected = connected; }
+
+    // A pad that samples its inputs (wireless receiver) misses latch and clock
+    // pulses shorter than 'cycles' and only acts on their falling edge. 0 is
+    // a plain shift register.
+    void setMinPulse(uint32_t cycles) { _minPulse = cycles; }
+
+    // Rising clock edges since the last latch
+    uint8_t clocks() const { return _clocks; }
+
+    virtual void reset();
+    virtual void outputsChanged();
+    virtual uint8_t pullsLow(uint8_t port);
+
+  private:
+    void load();
+    void shift();
+
+    uint8_t  _port;
+    uint8_t  _mask;
+    uint8_t  _length;
+    uint32_t _pressed;
+    bool     _connected;
+    uint32_t _shift;
+    uint8_t  _clocks;
+    bool     _clock;
+    bool     _latch;
+    uint32_t _minPulse;
+    uint64_t _latchRise;
+    uint64_t _clockRise;
+};
+
+#endif
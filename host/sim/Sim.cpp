@@ -0,0 +1,216 @@
+/*  Sim.cpp
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "Sim.h"
+
+#define SIM_MAX_DEVICES 8
+
+// Rough cost of the core's pin and time functions, they look up tables and save SREG
+#define CORE_CALL_CYCLES 40
+
+SimPortReg PINB(SIM_PORTB, SIM_REG_PIN), PORTB(SIM_PORTB, SIM_REG_PORT), DDRB(SIM_PORTB, SIM_REG_DDR);
+SimPortReg PINC(SIM_PORTC, SIM_REG_PIN), PORTC(SIM_PORTC, SIM_REG_PORT), DDRC(SIM_PORTC, SIM_REG_DDR);
+SimPortReg PIND(SIM_PORTD, SIM_REG_PIN), PORTD(SIM_PORTD, SIM_REG_PORT), DDRD(SIM_PORTD, SIM_REG_DDR);
+SimPortReg PINE(SIM_PORTE, SIM_REG_PIN), PORTE(SIM_PORTE, SIM_REG_PORT), DDRE(SIM_PORTE, SIM_REG_DDR);
+SimPortReg PINF(SIM_PORTF, SIM_REG_PIN), PORTF(SIM_PORTF, SIM_REG_PORT), DDRF(SIM_PORTF, SIM_REG_DDR);
+
+SimReg SREG;
+SimReg TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+SimTimer16 TCNT1;
+SimTimer8Low TCNT1L;
+
+EEPROMClass EEPROM;
+
+// Leonardo pin numbers as port << 4 | bit
+static const uint8_t arduinoPins[24] =
+{
+  SIM_PORTD << 4 | 2, SIM_PORTD << 4 | 3, SIM_PORTD << 4 | 1, SIM_PORTD << 4 | 0, // 0-3
+  SIM_PORTD << 4 | 4, SIM_PORTC << 4 | 6, SIM_PORTD << 4 | 7, SIM_PORTE << 4 | 6, // 4-7
+  SIM_PORTB << 4 | 4, SIM_PORTB << 4 | 5, SIM_PORTB << 4 | 6, SIM_PORTB << 4 | 7, // 8-11
+  SIM_PORTD << 4 | 6, SIM_PORTC << 4 | 7, SIM_PORTB << 4 | 3, SIM_PORTB << 4 | 1, // 12-15
+  SIM_PORTB << 4 | 2, SIM_PORTB << 4 | 0, SIM_PORTF << 4 | 7, SIM_PORTF << 4 | 6, // 16-19 (A0, A1)
+  SIM_PORTF << 4 | 5, SIM_PORTF << 4 | 4, SIM_PORTF << 4 | 1, SIM_PORTF << 4 | 0  // 20-23 (A2-A5)
+};
+
+namespace Sim
+{
+  uint64_t cycles;
+
+  static uint8_t port[SIM_PORTS];
+  static uint8_t ddr[SIM_PORTS];
+  static SimDevice *devices[SIM_MAX_DEVICES];
+  static uint8_t deviceCount;
+
+  static void notify()
+  {
+    for(uint8_t i = 0; i < deviceCount; i++)
+      devices[i]->outputsChanged();
+  }
+
+  void reset()
+  {
+    cycles = 0;
+    deviceCount = 0;
+
+    for(uint8_t p = 0; p < SIM_PORTS; p++)
+    {
+      port[p] = 0;
+      ddr[p] = 0;
+    }
+
+    SREG.value = 0;
+    TCCR1A.value = 0;
+    TCCR1B.value = 0;
+    TCCR1C.value = 0;
+    TIMSK1.value = 0;
+    TIFR1.value = 0;
+  }
+
+  void attach(SimDevice *device)
+  {
+    if(deviceCount == SIM_MAX_DEVICES)
+      return;
+
+    device->reset();
+    devices[deviceCount++] = device;
+  }
+
+  void advance(uint32_t n)
+  {
+    cycles += n;
+  }
+
+  bool outputLevel(uint8_t p, uint8_t bit)
+  {
+    if(ddr[p] & (1 << bit))
+      return port[p] & (1 << bit);
+
+    return true;
+  }
+
+  uint8_t readPort(uint8_t p)
+  {
+    return port[p];
+  }
+
+  uint8_t readDdr(uint8_t p)
+  {
+    return ddr[p];
+  }
+
+  uint8_t readPin(uint8_t p)
+  {
+    uint8_t low = 0;
+    for(uint8_t i = 0; i < deviceCount; i++)
+      low |= devices[i]->pullsLow(p);
+
+    // Outputs read back what they drive, inputs are pulled up unless a device pulls them low
+    return (ddr[p] & port[p]) | (~ddr[p] & ~low);
+  }
+
+  void writePort(uint8_t p, uint8_t value)
+  {
+    port[p] = value;
+    notify();
+  }
+
+  void writeDdr(uint8_t p, uint8_t value)
+  {
+    ddr[p] = value;
+    notify();
+  }
+
+  bool arduinoPin(uint8_t pin, uint8_t *p, uint8_t *bit)
+  {
+    if(pin >= sizeof(arduinoPins))
+      return false;
+
+    *p = arduinoPins[pin] >> 4;
+    *bit = arduinoPins[pin] & 0x0F;
+    return true;
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  uint8_t p, bit;
+  if(!Sim::arduinoPin(pin, &p, &bit))
+    return;
+
+  uint8_t mask = 1 << bit;
+
+  if(mode == OUTPUT)
+  {
+    Sim::writeDdr(p, Sim::readDdr(p) | mask);
+  }
+  else
+  {
+    Sim::writeDdr(p, Sim::readDdr(p) & ~mask);
+    Sim::writePort(p, (mode == INPUT_PULLUP) ? (Sim::readPort(p) | mask) : (Sim::readPort(p) & ~mask));
+  }
+
+  Sim::advance(CORE_CALL_CYCLES);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  uint8_t p, bit;
+  if(!Sim::arduinoPin(pin, &p, &bit))
+    return;
+
+  uint8_t mask = 1 << bit;
+  Sim::writePort(p, value ? (Sim::readPort(p) | mask) : (Sim::readPort(p) & ~mask));
+  Sim::advance(CORE_CALL_CYCLES);
+}
+
+int digitalRead(uint8_t pin)
+{
+  uint8_t p, bit;
+  if(!Sim::arduinoPin(pin, &p, &bit))
+    return LOW;
+
+  Sim::advance(CORE_CALL_CYCLES);
+  return (Sim::readPin(p) >> bit) & 1;
+}
+
+unsigned long micros(void)
+{
+  Sim::advance(CORE_CALL_CYCLES);
+  return Sim::cycles / SIM_CYCLES_PER_US;
+}
+
+unsigned long millis(void)
+{
+  Sim::advance(CORE_CALL_CYCLES);
+  return Sim::cycles / (SIM_CYCLES_PER_US * 1000UL);
+}
+
+void delay(unsigned long ms)
+{
+  Sim::advance(ms * SIM_CYCLES_PER_US * 1000UL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  Sim::advance(us * SIM_CYCLES_PER_US);
+}
@@ -0,0 +1,83 @@
+/*  Sim.h
+ *
+ *  Simulated ATmega32U4 I/O for the host build: a cycle counter that the
+ *  register accesses and delays advance, the port registers and the devices
+ *  attached to the pins. A device watches the levels the AVR drives and pulls
+ *  its data lines low, undriven inputs read high (pull-ups).
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef Sim_h
+#define Sim_h
+
+#include <stdint.h>
+
+enum
+{
+  SIM_PORTB = 0,
+  SIM_PORTC,
+  SIM_PORTD,
+  SIM_PORTE,
+  SIM_PORTF,
+  SIM_PORTS
+};
+
+#define SIM_CYCLES_PER_US 16
+
+class SimDevice
+{
+  public:
+    virtual ~SimDevice() {}
+
+    // Back to the idle bus state, called on attach
+    virtual void reset() {}
+
+    // Called after every PORTx/DDRx write
+    virtual void outputsChanged() {}
+
+    // Bits of 'port' the device pulls low right now
+    virtual uint8_t pullsLow(uint8_t port) { return 0; }
+};
+
+namespace Sim
+{
+  // AVR clock cycles since reset()
+  extern uint64_t cycles;
+
+  // Registers to power-on values, clock to 0, all devices detached
+  void reset();
+
+  // Resets the device and connects it to the pins
+  void attach(SimDevice *device);
+  void advance(uint32_t n);
+
+  // Level the AVR drives on a pin, released inputs count as high
+  bool outputLevel(uint8_t port, uint8_t bit);
+
+  uint8_t readPort(uint8_t port);
+  uint8_t readDdr(uint8_t port);
+  uint8_t readPin(uint8_t port);
+  void writePort(uint8_t port, uint8_t value);
+  void writeDdr(uint8_t port, uint8_t value);
+
+  // Arduino pin number to port/bit, false for pins the shim doesn't know
+  bool arduinoPin(uint8_t pin, uint8_t *port, uint8_t *bit);
+}
+
+#endif
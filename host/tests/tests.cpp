@@ -0,0 +1,1246 @@
+/*  tests.cpp
+ *
+ *  Regression tests of the controller drivers against the simulated pads.
+ *  Prints every failed check and exits non-zero if there was one.
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "Board.h"
+
+#include "NESSNES_Scanner.h"
+#include "SegaController32U4.h"
+#include "N64_Controller.h"
+#include "N64Stick.h"
+#include "PortPresence.h"
+#include "PressLatch.h"
+#include "NESController.h"
+#include "SNESController.h"
+#include "PadTables.h"
+
+static unsigned checks;
+static unsigned failures;
+
+#define CHECK_EQ(actual, expected) \
+  do { \
+    unsigned long long a_ = (actual), e_ = (expected); \
+    checks++; \
+    if(a_ != e_) \
+    { \
+      failures++; \
+      printf("%s:%d: %s is 0x%llx, expected 0x%llx\n", __FILE__, __LINE__, #actual, a_, e_); \
+    } \
+  } while(0)
+
+#define CHECK(condition) CHECK_EQ((condition) ? 1 : 0, 1)
+
+static Board board;
+
+static uint32_t randomState = 0x4DA97E12;
+
+static uint32_t random32()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+// Button words the original per-bit loops built, indexed by the bit shifted out
+static const uint32_t nesBits[4]         = { 0x02, 0x01, 0x40, 0x80 };                  // A, B, Start, Select
+static const uint32_t powerPadD4Bits[4]  = { 0x008, 0x004, 0x800, 0x080 };              // #4, #3, #12, #8
+static const uint32_t powerPadD3Bits[8]  = { 0x002, 0x001, 0x010, 0x100, 0x020, 0x200, 0x400, 0x040 };
+static const uint32_t snesBits[12]       = { 0x01, 0x04, 0x40, 0x80, 0, 0, 0, 0, 0x02, 0x08, 0x10, 0x20 };
+
+static uint32_t expand(uint32_t pressed, const uint32_t *bits, uint8_t count)
+{
+  uint32_t word = 0;
+  for(uint8_t i = 0; i < count; i++)
+  {
+    if(pressed & (1UL << i))
+      word |= bits[i];
+  }
+  return word;
+}
+
+static void test_scanner_nes()
+{
+  NESSNESScanner scanner;
+  uint32_t data[2][2];
+
+  board.reset();
+
+  for(uint16_t pressed = 0; pressed < 256; pressed++)
+  {
+    board.nes.setPressed(pressed);
+    scanner.scan(data);
+
+    CHECK_EQ(data[NES][BUTTONS], expand(pressed, nesBits, 4));
+    CHECK_EQ(data[NES][AXES], pressed >> 4);
+    CHECK_EQ(data[SNES][BUTTONS], 0);
+    CHECK(!scanner.nttActive);
+
+    // No NTT indicator, the scan stops after bit 14
+    CHECK_EQ(board.nes.clocks(), SNES_BITS);
+  }
+}
+
+static void test_scanner_powerpad()
+{
+  NESSNESScanner scanner;
+  uint32_t data[2][2];
+
+  board.reset();
+
+  for(uint16_t d3 = 0; d3 < 256; d3++)
+  {
+    for(uint8_t d4 = 0; d4 < 16; d4++)
+    {
+      board.powerPadD3.setPressed(d3);
+      board.powerPadD4.setPressed(d4);
+      scanner.scan(data);
+
+      CHECK_EQ(data[NES][BUTTONS], expand(d3, powerPadD3Bits, 8) | expand(d4, powerPadD4Bits, 4));
+      CHECK_EQ(data[NES][AXES], 0);
+    }
+  }
+}
+
+static void test_scanner_snes()
+{
+  NESSNESScanner scanner;
+  uint32_t data[2][2];
+
+  board.reset();
+
+  for(uint16_t pressed = 0; pressed < 4096; pressed++)
+  {
+    board.snes.setPressed(pressed);
+    scanner.scan(data);
+
+    CHECK_EQ(data[SNES][BUTTONS], expand(pressed, snesBits, 12));
+    CHECK_EQ(data[SNES][AXES], (pressed >> 4) & 0x0F);
+    CHECK_EQ(data[NES][BUTTONS], 0);
+  }
+}
+
+static void test_scanner_ntt()
+{
+  NESSNESScanner scanner;
+  uint32_t data[2][2];
+
+  board.reset();
+
+  for(uint8_t key = 0; key < 16; key++)
+  {
+    uint32_t buttons = random32() & 0x0FFF;
+    board.snes.setPressed((1UL << 13) | (1UL << (16 + key)) | buttons);
+    scanner.scan(data);
+
+    // Bit 30 of the stream carries no key
+    uint32_t keyBit = (key == 14) ? 0 : (1UL << (8 + key));
+
+    CHECK(scanner.nttActive);
+    CHECK_EQ(board.snes.clocks(), NTT_BITS);
+    CHECK_EQ(data[SNES][BUTTONS], expand(buttons, snesBits, 12) | keyBit);
+  }
+}
+
+// The HID loop spreads a scan over the Genesis select cycles, same result
+static void test_scanner_split()
+{
+  NESSNESScanner scanner;
+  uint32_t whole[2][2];
+  uint32_t split[2][2];
+
+  board.reset();
+
+  for(uint16_t i = 0; i < 500; i++)
+  {
+    board.nes.setPressed(random32() & 0xFF);
+    board.powerPadD3.setPressed(random32() & 0xFF);
+    board.snes.setPressed(random32() & ((i & 1) ? 0xFFFF2FFF : 0x0FFF));
+
+    scanner.scan(whole);
+
+    scanner.begin();
+    for(uint8_t cycle = 0; cycle < 8; cycle++)
+    {
+      if(!scanner.step())
+        delayMicroseconds(SC_CYCLE_DELAY);
+    }
+    while(scanner.step());
+    scanner.finish(split);
+
+    CHECK_EQ(split[NES][BUTTONS], whole[NES][BUTTONS]);
+    CHECK_EQ(split[NES][AXES], whole[NES][AXES]);
+    CHECK_EQ(split[SNES][BUTTONS], whole[SNES][BUTTONS]);
+    CHECK_EQ(split[SNES][AXES], whole[SNES][AXES]);
+  }
+}
+
+// BusSampler drives the scan one edge per timer interrupt, same result
+static void test_scanner_edges()
+{
+  NESSNESScanner scanner;
+  uint32_t whole[2][2];
+  uint32_t edges[2][2];
+
+  board.reset();
+
+  for(uint16_t i = 0; i < 500; i++)
+  {
+    board.nes.setPressed(random32() & 0xFF);
+    board.powerPadD3.setPressed(random32() & 0xFF);
+    board.snes.setPressed(random32() & ((i & 1) ? 0xFFFF2FFF : 0x0FFF));
+
+    scanner.scan(whole);
+
+    uint8_t count = 0;
+    scanner.beginEdges(i & 2);
+    while(scanner.edge())
+    {
+      count++;
+      delayMicroseconds(12);
+    }
+    scanner.finish(edges);
+
+    CHECK_EQ(edges[NES][BUTTONS], whole[NES][BUTTONS]);
+    CHECK_EQ(edges[NES][AXES], whole[NES][AXES]);
+    CHECK_EQ(edges[SNES][BUTTONS], whole[SNES][BUTTONS]);
+    CHECK_EQ(edges[SNES][AXES], whole[SNES][AXES]);
+
+    // Latch low, then a clock high and low per bit, lines idle low after
+    CHECK_EQ(count, 1 + 2 * board.snes.clocks());
+    CHECK_EQ(PORTD & B00000011, 0);
+  }
+}
+
+static const struct
+{
+  uint16_t pad;
+  word expected;
+} genesisButtons[] =
+{
+  { GEN_UP,    SC_BTN_UP    },
+  { GEN_DOWN,  SC_BTN_DOWN  },
+  { GEN_LEFT,  SC_BTN_LEFT  },
+  { GEN_RIGHT, SC_BTN_RIGHT },
+  { GEN_A,     SC_BTN_A     },
+  { GEN_B,     SC_BTN_B     },
+  { GEN_C,     SC_BTN_C     },
+  { GEN_START, SC_BTN_START },
+  { GEN_X,     SC_BTN_X     },
+  { GEN_Y,     SC_BTN_Y     },
+  { GEN_Z,     SC_BTN_Z     },
+  { GEN_MODE,  SC_BTN_MODE  },
+  { GEN_HOME,  SC_BTN_HOME  }
+};
+
+#define GENESIS_BUTTONS (sizeof(genesisButtons) / sizeof(genesisButtons[0]))
+#define GENESIS_THREE_BUTTONS 8
+
+// One read of the HID loop, after the 6 button reset time
+static word genesisScan(SegaController32U4 &controller)
+{
+  delayMicroseconds(SC_RESET_DELAY);
+
+  for(uint8_t cycle = 0; cycle < 8; cycle++)
+    controller.updateState();
+
+  return controller.getFinalState();
+}
+
+static bool probeBus(NESSNESScanner &scanner)
+{
+  uint32_t data[2][2];
+
+  scanner.begin(true);
+  while(scanner.step());
+  scanner.finish(data);
+  return scanner.padsPresent;
+}
+
+static void test_scanner_presence()
+{
+  board.reset();
+  board.snes.setLength(16); // A standard pad, not the NTT keypad
+  NESSNESScanner scanner;
+  uint32_t data[2][2];
+
+  CHECK(probeBus(scanner));
+  CHECK_EQ(board.nes.clocks(), PRESENCE_BITS);
+
+  // Bit 17 of a plain SNES pad reads grounded, which is not NTT key 0
+  scanner.begin(true);
+  while(scanner.step());
+  scanner.finish(data);
+  CHECK(!scanner.nttActive);
+  CHECK_EQ(data[SNES][BUTTONS], 0);
+
+  // Each pad alone is found, idle or not
+  board.nes.setConnected(false);
+  board.powerPadD3.setConnected(false);
+  board.powerPadD4.setConnected(false);
+  CHECK(probeBus(scanner));
+
+  board.snes.setConnected(false);
+  CHECK(!probeBus(scanner));
+
+  board.nes.setConnected(true);
+  CHECK(probeBus(scanner));
+  board.nes.setConnected(false);
+
+  board.powerPadD4.setConnected(true);
+  CHECK(probeBus(scanner));
+  board.powerPadD4.setConnected(false);
+  CHECK(!probeBus(scanner));
+
+  // An empty bus reads released and a normal scan leaves the result alone
+  scanner.scan(data);
+  CHECK_EQ(board.nes.clocks(), SNES_BITS);
+  CHECK(!scanner.padsPresent);
+  CHECK_EQ(data[NES][BUTTONS] | data[SNES][BUTTONS], 0);
+
+  // The NTT keypad still gets all its bits on a probe
+  board.snes.setConnected(true);
+  board.snes.setLength(32);
+  board.snes.setPressed(1UL << 13);
+  CHECK(probeBus(scanner));
+  CHECK_EQ(board.snes.clocks(), NTT_BITS);
+}
+
+// Cycles of a whole SNES read at the scanner's current timing
+static uint64_t snesReadCycles(NESSNESScanner &scanner, uint32_t data[2][2])
+{
+  uint64_t start = Sim::cycles;
+  scanner.scan(data);
+  return Sim::cycles - start;
+}
+
+static void test_scanner_timing()
+{
+  NESSNESScanner scanner;
+  NESSNESScanner safeScanner;
+  uint32_t reference[2][2];
+  uint32_t data[2][2];
+
+  board.reset();
+  board.snes.setLength(16);
+  CHECK_EQ(scanner.timing(), BUS_TIMING_SAFE);
+  uint64_t safe = snesReadCycles(scanner, data);
+
+  // Shift registers keep up with the fastest step
+  CHECK_EQ(scanner.calibrate(), 2);
+  uint64_t fast = snesReadCycles(scanner, data);
+  CHECK(fast < 60 * SIM_CYCLES_PER_US);
+  CHECK(fast * 3 < safe);
+
+  // Spent on a 10us settle time, several fast steps fit but it never comes
+  // out shorter
+  board.snes.setPressed(0x0A5A);
+  scanner.begin();
+  uint8_t calls = 0;
+  bool more = true;
+
+  while(more)
+  {
+    uint64_t start = Sim::cycles;
+    more = scanner.stepFor(10);
+    uint64_t took = Sim::cycles - start;
+    CHECK(took >= 10 * SIM_CYCLES_PER_US);
+    CHECK(took < 14 * SIM_CYCLES_PER_US);
+    calls++;
+  }
+
+  scanner.finish(data);
+  CHECK_EQ(data[SNES][BUTTONS], expand(0x0A5A, snesBits, 12));
+  CHECK(calls <= 4);
+
+  for(uint16_t i = 0; i < 200; i++)
+  {
+    board.nes.setPressed(random32() & 0xFF);
+    board.snes.setPressed(random32() & 0x0FFF);
+    safeScanner.scan(reference);
+    scanner.calibrate();
+    scanner.scan(data);
+    CHECK_EQ(data[NES][BUTTONS], reference[NES][BUTTONS]);
+    CHECK_EQ(data[SNES][BUTTONS], reference[SNES][BUTTONS]);
+    CHECK_EQ(data[SNES][AXES], reference[SNES][AXES]);
+  }
+
+  // A receiver that needs 4us pulses: the clock is high 6 cycles per step,
+  // 11 steps plus margin
+  board.snes.setMinPulse(4 * SIM_CYCLES_PER_US);
+  CHECK_EQ(scanner.calibrate(), 14);
+
+  for(uint16_t i = 0; i < 200; i++)
+  {
+    uint32_t pressed = random32() & 0x0FFF;
+    board.snes.setPressed(pressed);
+    scanner.scan(data);
+    CHECK_EQ(data[SNES][BUTTONS], expand(pressed, snesBits, 12));
+  }
+
+  // Probes run at the safe timing, so plugging in the receiver next to the
+  // NES pad is noticed while the bus runs fast
+  board.snes.setMinPulse(0);
+  board.snes.setConnected(false);
+  CHECK(probeBus(scanner));
+  CHECK(scanner.padsChanged);
+  CHECK_EQ(scanner.calibrate(), 2);
+  CHECK(probeBus(scanner));
+  CHECK(!scanner.padsChanged);
+  board.snes.setConnected(true);
+  board.snes.setMinPulse(4 * SIM_CYCLES_PER_US);
+  CHECK(probeBus(scanner));
+  CHECK(scanner.padsChanged);
+  CHECK_EQ(scanner.calibrate(), 14);
+}
+
+static void test_port_presence()
+{
+  PortPresence port;
+
+  // Present until a read says otherwise
+  CHECK(port.due(5000));
+  port.update(false, 5000);
+  CHECK(!port.due(5001));
+  CHECK(!port.due(5000 + PRESENCE_PROBE_MS - 1));
+  CHECK(port.due(5000 + PRESENCE_PROBE_MS));
+  CHECK(port.probeDue(5000 + PRESENCE_PROBE_MS));
+
+  port.update(true, 5100);
+  CHECK(port.due(5101));
+  CHECK(!port.probeDue(5101));
+
+  // millis() wrapping around
+  port.update(false, ~0UL - 15);
+  CHECK(!port.due(0x10));
+  CHECK(port.due(PRESENCE_PROBE_MS));
+}
+
+static void test_press_latch()
+{
+  PressLatch latch;
+
+  // A tap between two reports is held until a report with it was delivered
+  CHECK_EQ(latch.sample(0x01), 0x01);
+  CHECK_EQ(latch.sample(0x00), 0x01);
+  latch.delivered();
+  CHECK_EQ(latch.sample(0x00), 0x01);
+  latch.sent();
+  CHECK_EQ(latch.sample(0x02), 0x03);
+  latch.delivered();
+  CHECK_EQ(latch.sample(0x00), 0x02);
+
+  // A held button stays, the unchanged reports are not sent again
+  latch.sent();
+  latch.delivered();
+  CHECK_EQ(latch.sample(0x04), 0x04);
+  latch.sent();
+  latch.delivered();
+  CHECK_EQ(latch.sample(0x04), 0x04);
+  latch.delivered();
+  CHECK_EQ(latch.sample(0x04), 0x04);
+
+  // Released with the next scan, the host holds a report with it
+  latch.delivered();
+  CHECK_EQ(latch.sample(0x00), 0x00);
+}
+
+// The firmware loops around the latch: a report only goes out when it
+// changed and the host collected the previous one, the host collects one
+// every 'interval' passes.
+static void test_press_latch_loop()
+{
+  static const struct
+  {
+    uint8_t interval;
+    uint8_t holdPasses;
+  } cases[] = { { 1, 1 }, { 1, 10 }, { 4, 1 }, { 4, 3 }, { 4, 13 }, { 8, 40 } };
+
+  for(uint8_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+  {
+    PressLatch latch;
+    uint32_t hostReport = 0;   // Last report the host collected
+    uint32_t lastSent = 0;
+    bool pending = false;
+    unsigned pressedReports = 0;
+    int releasedPass = -1;
+
+    for(unsigned pass = 0; pass < 200; pass++)
+    {
+      bool held = (pass >= 5 && pass < 5u + cases[c].holdPasses);
+
+      if(pending && pass % cases[c].interval == 0)
+      {
+        hostReport = lastSent;
+        pending = false;
+        pressedReports += hostReport & 0x01;
+        if(!hostReport && releasedPass < 0 && pressedReports)
+          releasedPass = pass;
+      }
+
+      if(!pending)
+        latch.delivered();
+
+      uint32_t report = latch.sample(held ? 0x01 : 0x00);
+
+      if(!pending && report != lastSent)
+      {
+        lastSent = report;
+        pending = true;
+        latch.sent();
+      }
+    }
+
+    // The press reached the host and was released within a few reports of the
+    // button going up
+    CHECK(pressedReports > 0);
+    CHECK_EQ(hostReport, 0);
+    CHECK(releasedPass >= 0);
+    CHECK(releasedPass - (5 + cases[c].holdPasses) <= 2 * cases[c].interval);
+  }
+}
+
+static void test_genesis_three_button()
+{
+  board.reset();
+  board.genesis.setSixButton(false);
+  SegaController32U4 controller(0);
+
+  for(uint8_t i = 0; i < GENESIS_BUTTONS; i++)
+  {
+    board.genesis.setPressed(genesisButtons[i].pad);
+    CHECK_EQ(genesisScan(controller), (i < GENESIS_THREE_BUTTONS) ? genesisButtons[i].expected : 0);
+  }
+
+  board.genesis.setPressed(GEN_A | GEN_B | GEN_C | GEN_START);
+  CHECK_EQ(genesisScan(controller), SC_BTN_A | SC_BTN_B | SC_BTN_C | SC_BTN_START);
+  CHECK(!controller.sixButton());
+
+  // No select counter to reset, so the HID loop reads it every frame
+  for(uint8_t i = 0; i < GENESIS_THREE_BUTTONS; i++)
+  {
+    board.genesis.setPressed(genesisButtons[i].pad);
+
+    for(uint8_t cycle = 0; cycle < 8; cycle++)
+      controller.updateState();
+    CHECK_EQ(controller.getFinalState(), genesisButtons[i].expected);
+  }
+}
+
+static void test_genesis_six_button()
+{
+  board.reset();
+  SegaController32U4 controller(0);
+
+  for(uint8_t i = 0; i < GENESIS_BUTTONS; i++)
+  {
+    board.genesis.setPressed(genesisButtons[i].pad);
+
+    // Repeated reads must stay in step with the pad's select counter
+    for(uint8_t repeat = 0; repeat < 3; repeat++)
+      CHECK_EQ(genesisScan(controller), genesisButtons[i].expected);
+  }
+
+  board.genesis.setPressed(GEN_X | GEN_Y | GEN_Z | GEN_MODE | GEN_LEFT | GEN_A);
+  CHECK_EQ(genesisScan(controller), SC_BTN_X | SC_BTN_Y | SC_BTN_Z | SC_BTN_MODE | SC_BTN_LEFT | SC_BTN_A);
+  CHECK(controller.sixButton());
+
+  // Swapped for a 3-button pad, the next read lifts the reset delay
+  board.genesis.setSixButton(false);
+  genesisScan(controller);
+  CHECK(!controller.sixButton());
+}
+
+static void test_genesis_disconnected()
+{
+  board.reset();
+  board.genesis.setConnected(false);
+  SegaController32U4 controller(0);
+
+  CHECK_EQ(genesisScan(controller), 0);
+}
+
+static void test_genesis_input_active()
+{
+  board.reset();
+  SegaController32U4 controller(0);
+
+  // Idle Mega Drive pad and empty port look the same between reads
+  CHECK(!controller.inputActive());
+  board.genesis.setConnected(false);
+  CHECK(!controller.inputActive());
+
+  board.genesis.setConnected(true);
+  board.genesis.setPressed(GEN_RIGHT);
+  CHECK(controller.inputActive());
+  board.genesis.setPressed(GEN_C);
+  CHECK(controller.inputActive());
+
+  // connected() only after a read
+  board.genesis.setPressed(0);
+  genesisScan(controller);
+  CHECK(controller.connected());
+  board.genesis.setConnected(false);
+  genesisScan(controller);
+  CHECK(!controller.connected());
+}
+
+static void test_n64_status()
+{
+  board.reset();
+  N64Controller controller;
+  controller.N64_init();
+
+  for(uint16_t i = 0; i < 500; i++)
+  {
+    uint32_t state = random32() & ~0x4000UL; // The 0 bit of the second byte
+    board.n64.setState(state, state >> 8, state >> 16, state >> 24);
+
+    controller.getN64Packet();
+
+    CHECK_EQ(controller.N64_status.data1, state & 0xFF);
+    CHECK_EQ(controller.N64_status.data2, (state >> 8) & 0xFF);
+    CHECK_EQ((uint8_t)controller.N64_status.stick_x, (state >> 16) & 0xFF);
+    CHECK_EQ((uint8_t)controller.N64_status.stick_y, state >> 24);
+    CHECK_EQ(board.n64.lastCommand, N64_GET_STATUS);
+  }
+}
+
+static void test_n64_disconnected()
+{
+  board.reset();
+  N64Controller controller;
+  controller.N64_init();
+
+  board.n64.setState(0x90, 0x20, 10, -10);
+  controller.getN64Packet();
+  CHECK_EQ(controller.N64_status.data1, 0x90);
+
+  board.n64.setConnected(false);
+  uint64_t start = Sim::cycles;
+  controller.getN64Packet();
+
+  // The command is ~40us, the reply wait must give up shortly after
+  CHECK(Sim::cycles - start < 200 * SIM_CYCLES_PER_US);
+  CHECK_EQ(controller.replyBits, 0);
+
+  // Unplugged releases everything
+  CHECK_EQ(controller.N64_status.data1, 0);
+  CHECK_EQ(controller.N64_status.data2, 0);
+  CHECK_EQ(controller.N64_status.stick_x, 0);
+  CHECK_EQ(controller.N64_status.stick_y, 0);
+}
+
+static void test_n64_short_reply()
+{
+  board.reset();
+  N64Controller controller;
+  controller.N64_init();
+
+  board.n64.setState(0x11, 0x22, 33, -44);
+  controller.getN64Packet();
+  CHECK_EQ(controller.replyBits, 32);
+
+  // One short reply is retried
+  board.n64.setState(0x81, 0x02, 5, 6);
+  board.n64.truncateReplies(20, 1);
+  uint32_t commands = board.n64.commands;
+  controller.getN64Packet();
+  CHECK_EQ(board.n64.commands - commands, 2);
+  CHECK_EQ(controller.replyBits, 32);
+  CHECK_EQ(controller.N64_status.data1, 0x81);
+  CHECK_EQ(controller.N64_status.stick_y, 6);
+
+  // Two in a row keep the last good state
+  board.n64.setState(0xFF, 0x3F, -1, -1);
+  board.n64.truncateReplies(20, 2);
+  controller.getN64Packet();
+  CHECK(controller.replyBits != 32);
+  CHECK_EQ(controller.N64_status.data1, 0x81);
+  CHECK_EQ(controller.N64_status.data2, 0x02);
+  CHECK_EQ(controller.N64_status.stick_x, 5);
+  CHECK_EQ(controller.N64_status.stick_y, 6);
+
+  // So does a reply with the always 0 bit set
+  board.n64.setState(0xFF, 0x7F, -1, -1);
+  controller.getN64Packet();
+  CHECK_EQ(controller.replyBits, 32);
+  CHECK_EQ(controller.N64_status.data1, 0x81);
+
+  board.n64.setState(0xFF, 0x3F, -1, -1);
+  controller.getN64Packet();
+  CHECK_EQ(controller.N64_status.data1, 0xFF);
+  CHECK_EQ(controller.N64_status.data2, 0x3F);
+}
+
+static void test_n64_rumble()
+{
+  board.reset();
+  board.n64.setPak(PAK_RUMBLE);
+  N64Controller controller;
+  controller.N64_init();
+
+  CHECK(controller.checkRumblePak());
+  CHECK_EQ(board.n64.lastAddress, RUMBLEPAK_INIT_ADDRESS);
+
+  controller.setRumble(true);
+  CHECK(board.n64.rumble());
+  CHECK_EQ(board.n64.lastAddress, RUMBLEPAK_CTRL_ADDRESS);
+
+  controller.setRumble(false);
+  CHECK(!board.n64.rumble());
+
+  CHECK_EQ(board.n64.pakWrites, 3);
+  CHECK_EQ(board.n64.addressCrcErrors, 0);
+
+  // Polling keeps working after the long write commands
+  board.n64.setState(0x81, 0x22, -5, 100);
+  controller.getN64Packet();
+  CHECK_EQ(controller.N64_status.data1, 0x81);
+  CHECK_EQ(controller.N64_status.stick_y, 100);
+}
+
+static void test_n64_pak_blocks()
+{
+  board.reset();
+  board.n64.setPak(PAK_MEMORY);
+  N64Controller controller;
+  controller.N64_init();
+
+  uint8_t block[N64_PAK_BLOCK_SIZE];
+  uint8_t readBack[N64_PAK_BLOCK_SIZE];
+
+  // Every block of a 32KB pak written and read back
+  for(uint16_t address = 0; address < N64_PAK_SIZE; address += N64_PAK_BLOCK_SIZE)
+  {
+    for(uint8_t i = 0; i < N64_PAK_BLOCK_SIZE; i++)
+      block[i] = random32();
+
+    CHECK_EQ(controller.writePakBlock(address, block), N64_PAK_OK);
+    CHECK_EQ(board.n64.lastAddress, N64Controller::pakAddress(address));
+    CHECK_EQ(memcmp(&board.n64.pakMemory()[address], block, sizeof(block)), 0);
+
+    memset(readBack, 0, sizeof(readBack));
+    CHECK_EQ(controller.readPakBlock(address, readBack), N64_PAK_OK);
+    CHECK_EQ(memcmp(readBack, block, sizeof(block)), 0);
+  }
+
+  CHECK_EQ(board.n64.addressCrcErrors, 0);
+
+  // Without a pak the CRC comes back inverted
+  board.n64.setPak(PAK_NONE);
+  CHECK_EQ(controller.readPakBlock(0x0000, readBack), N64_PAK_NO_PAK);
+  CHECK_EQ(controller.writePakBlock(0x0000, block), N64_PAK_NO_PAK);
+
+  board.n64.setPak(PAK_MEMORY);
+  board.n64.truncateReplies(100, 1);
+  CHECK_EQ(controller.readPakBlock(0x0020, readBack), N64_PAK_NO_REPLY);
+
+  board.n64.setConnected(false);
+  CHECK_EQ(controller.readPakBlock(0x0020, readBack), N64_PAK_NO_REPLY);
+  CHECK_EQ(controller.writePakBlock(0x0020, block), N64_PAK_NO_REPLY);
+  board.n64.setConnected(true);
+
+  board.n64.setState(0x81, 0x22, -5, 100);
+  controller.getN64Packet();
+  CHECK_EQ(controller.N64_status.data1, 0x81);
+  CHECK_EQ(controller.N64_status.stick_y, 100);
+}
+
+#define STICK_EEPROM 1
+
+static N64_status_packet stickStatus(int8_t x, int8_t y, uint8_t data2)
+{
+  N64_status_packet status;
+  status.stick_x = x;
+  status.stick_y = y;
+  status.data1 = 0;
+  status.data2 = data2;
+  return status;
+}
+
+static void test_gamecube()
+{
+  board.reset();
+  // Rests off center when powered up, the origin command reports that
+  board.n64.setGameCubeState(0x00, 0x00, 130, 125, 120, 140, 20, 30);
+  board.n64.setGameCube(true);
+  N64Controller controller;
+  controller.N64_init();
+
+  controller.getN64Packet();
+  CHECK_EQ(controller.controllerType, JOYBUS_GAMECUBE);
+  CHECK_EQ(controller.replyBits, 64);
+  CHECK(!board.n64.gameCubeOriginPending());
+
+  // 25 command and 65 reply bits, well inside the 1ms frame with the other ports
+  uint64_t start = Sim::cycles;
+  controller.getN64Packet();
+  CHECK(Sim::cycles - start < 400 * SIM_CYCLES_PER_US);
+  CHECK_EQ(board.n64.lastCommand, GC_POLL);
+  CHECK_EQ(controller.GC_status.stick_x, 128);
+  CHECK_EQ(controller.GC_status.stick_y, 128);
+  CHECK_EQ(controller.GC_status.cstick_x, 128);
+  CHECK_EQ(controller.GC_status.trigger_l, 0);
+  CHECK_EQ(controller.N64_status.stick_x, 0);
+
+  // Movement relative to the origin, clamped
+  board.n64.setGameCubeState(GC_BTN_A | GC_BTN_X, GC_BTN_Z | GC_BTN_DLEFT | GC_BTN_DUP,
+                             230, 5, 200, 140, 220, 10);
+  controller.getN64Packet();
+  CHECK_EQ(controller.GC_status.buttons1, GC_BTN_A | GC_BTN_X);
+  CHECK_EQ(controller.GC_status.stick_x, 228);
+  CHECK_EQ(controller.GC_status.stick_y, 8);
+  CHECK_EQ(controller.GC_status.cstick_x, 208);
+  CHECK_EQ(controller.GC_status.trigger_l, 200);
+  CHECK_EQ(controller.GC_status.trigger_r, 0);
+
+  // N64 view: A, Z, Dup, Dleft, C-right
+  CHECK_EQ(controller.N64_status.data1, 0x80 | 0x20 | 0x08 | 0x02);
+  CHECK_EQ(controller.N64_status.data2, 0x01);
+  CHECK_EQ(controller.N64_status.stick_x, 100);
+  CHECK_EQ(controller.N64_status.stick_y, -120);
+
+  // A clicked trigger is all the way in
+  board.n64.setGameCubeState(0x00, GC_BTN_R, 130, 125, 120, 140, 20, 150);
+  controller.getN64Packet();
+  CHECK_EQ(controller.GC_status.trigger_r, 255);
+  CHECK_EQ(controller.N64_status.data2, 0x10);
+
+  // The rumble byte goes out with the next poll
+  uint32_t pakWrites = board.n64.pakWrites;
+  controller.setRumble(true);
+  controller.getN64Packet();
+  CHECK(board.n64.gameCubeRumble());
+  CHECK_EQ(board.n64.pakWrites, pakWrites);
+  controller.setRumble(false);
+  controller.getN64Packet();
+  CHECK(!board.n64.gameCubeRumble());
+
+  // Origin taken again on request (X + Y + Start). The stick has moved by
+  // the time of the poll, it counts from the origin the pad reports.
+  board.n64.setGameCubeState(0x00, 0x00, 140, 140, 128, 128, 0, 0);
+  board.n64.resetGameCubeOrigin();
+  board.n64.setGameCubeState(0x00, 0x00, 200, 140, 128, 128, 0, 0);
+  controller.getN64Packet();
+  CHECK(!board.n64.gameCubeOriginPending());
+  CHECK_EQ(controller.GC_status.stick_x, 188);
+  CHECK_EQ(controller.GC_status.stick_y, 128);
+  board.n64.setGameCubeState(0x00, 0x00, 130, 125, 128, 128, 0, 0);
+  controller.getN64Packet();
+  CHECK_EQ(board.n64.lastCommand, GC_POLL);
+  CHECK_EQ(controller.GC_status.stick_x, 118);
+
+  // Unplugged and swapped for an N64 controller
+  board.n64.setConnected(false);
+  controller.getN64Packet();
+  CHECK_EQ(controller.controllerType, JOYBUS_NONE);
+  CHECK_EQ(controller.N64_status.data1, 0);
+
+  board.n64.setConnected(true);
+  board.n64.setGameCube(false);
+  board.n64.setState(0x90, 0x20, 10, -10);
+  controller.getN64Packet();
+  CHECK_EQ(controller.controllerType, JOYBUS_N64);
+  CHECK_EQ(controller.N64_status.data1, 0x90);
+}
+
+static void test_n64_stick_table()
+{
+  memset(&EEPROM.data[STICK_EEPROM], 0xFF, N64_STICK_EEPROM_SIZE);
+
+  // DInput: signed, up is negative
+  N64Stick dinput(STICK_EEPROM, N64_STICK_SIGNED, true, 80, 3, true);
+  CHECK_EQ((int8_t)dinput.x(0), 0);
+  CHECK_EQ((int8_t)dinput.x(3), 0);
+  CHECK_EQ((int8_t)dinput.x(-3), 0);
+  CHECK_EQ((int8_t)dinput.x(4), 1);
+  CHECK_EQ((int8_t)dinput.x(80), 127);
+  CHECK_EQ((int8_t)dinput.x(127), 127);
+  CHECK_EQ((int8_t)dinput.x(-80), -128);
+  CHECK_EQ((int8_t)dinput.x(-128), -128);
+  CHECK_EQ((int8_t)dinput.y(80), -128);
+  CHECK_EQ((int8_t)dinput.y(-80), 127);
+
+  // Y mirrors X, pointing down it reaches one step further
+  for(int raw = 1; raw < 128; raw++)
+  {
+    int8_t x = dinput.x(raw);
+    CHECK_EQ((int8_t)dinput.y(raw), -x - (x >= 64 ? 1 : 0));
+  }
+
+  for(int raw = -127; raw < 128; raw++)
+  {
+    CHECK((int8_t)dinput.x(raw) >= (int8_t)dinput.x(raw - 1));
+  }
+
+  // XInput: unsigned, up is positive
+  N64Stick xinput(STICK_EEPROM, N64_STICK_UNSIGNED, false, 80, 0, true);
+  CHECK_EQ(xinput.x(0), 128);
+  CHECK_EQ(xinput.x(80), 255);
+  CHECK_EQ(xinput.x(-80), 0);
+  CHECK_EQ(xinput.y(80), 255);
+  CHECK_EQ(xinput.y(-80), 0);
+
+  // Not scaled: deadzone only
+  N64Stick raw(STICK_EEPROM, N64_STICK_SIGNED, true, 80, 3, false);
+  CHECK_EQ((int8_t)raw.x(2), 0);
+  CHECK_EQ((int8_t)raw.x(50), 50);
+  CHECK_EQ((int8_t)raw.x(100), 100);
+  CHECK_EQ((int8_t)raw.y(50), -50);
+  CHECK_EQ((int8_t)raw.y(-128), 127);
+
+  // The fixed point scale matches (magnitude - deadzone) * 127 / span for
+  // every travel and deadzone
+  for(int travel = N64_STICK_MIN_TRAVEL; travel <= 127; travel++)
+  {
+    for(int deadzone = 0; deadzone < 16; deadzone++)
+    {
+      N64Stick stick(STICK_EEPROM, N64_STICK_SIGNED, false, travel, deadzone, true);
+
+      for(int magnitude = deadzone + 1; magnitude <= 127; magnitude++)
+      {
+        int clamped = (magnitude < travel) ? magnitude : travel;
+        CHECK_EQ(stick.x(magnitude), (clamped - deadzone) * 127 / (travel - deadzone));
+      }
+    }
+  }
+}
+
+static void test_n64_stick_calibration()
+{
+  memset(&EEPROM.data[STICK_EEPROM], 0xFF, N64_STICK_EEPROM_SIZE);
+
+  N64Stick stick(STICK_EEPROM, N64_STICK_SIGNED, true, 80, 3, true);
+
+  // A single glitched read doesn't widen the travel
+  stick.update(stickStatus(127, 0, 0));
+  stick.update(stickStatus(40, 0, 0));
+  CHECK_EQ(stick.travel(0), 80);
+
+  // A stick with more travel than the default learns it, as far as it
+  // reached on all reads in a row
+  stick.update(stickStatus(92, 0, 0));
+  stick.update(stickStatus(90, 0, 0));
+  stick.update(stickStatus(91, 0, 0));
+  CHECK_EQ(stick.travel(0), 90);
+  CHECK_EQ((int8_t)stick.x(90), 127);
+  CHECK((int8_t)stick.x(80) < 127);
+
+  // Saved once back in the center only, one byte per update with the
+  // marker last
+  CHECK_EQ(EEPROM.data[STICK_EEPROM], 0xFF);
+  stick.update(stickStatus(0, 0, 0));
+  CHECK_EQ(EEPROM.data[STICK_EEPROM + 1], 90);
+  CHECK_EQ(EEPROM.data[STICK_EEPROM + 2], 0xFF);
+
+  for(uint8_t i = 0; i < N64_STICK_EEPROM_SIZE - 2; i++)
+    stick.update(stickStatus(0, 0, 0));
+  CHECK_EQ(EEPROM.data[STICK_EEPROM + 4], 80);
+  CHECK_EQ(EEPROM.data[STICK_EEPROM], 0xFF);
+
+  stick.update(stickStatus(0, 0, 0));
+  CHECK(EEPROM.data[STICK_EEPROM] != 0xFF);
+
+  N64Stick reloaded(STICK_EEPROM, N64_STICK_SIGNED, true, 80, 3, true);
+  CHECK_EQ(reloaded.travel(0), 90);
+  CHECK_EQ(reloaded.travel(1), 80);
+  CHECK_EQ((int8_t)reloaded.x(90), 127);
+
+  // L + R + Start starts over, a worn stick then reaches full deflection
+  reloaded.update(stickStatus(0, 0, 0xB0));
+  reloaded.update(stickStatus(0, 0, 0xB0));
+  for(uint8_t d = 0; d < 4; d++)
+    CHECK_EQ(reloaded.travel(d), N64_STICK_MIN_TRAVEL);
+
+  reloaded.update(stickStatus(0, 0, 0));
+  for(uint8_t i = 0; i < N64_STICK_GROW_READINGS; i++)
+    reloaded.update(stickStatus(62, -60, 0));
+  for(uint8_t i = 0; i < N64_STICK_GROW_READINGS; i++)
+    reloaded.update(stickStatus(-58, 61, 0));
+  for(uint8_t i = 0; i < N64_STICK_EEPROM_SIZE; i++)
+    reloaded.update(stickStatus(0, 0, 0));
+  CHECK_EQ((int8_t)reloaded.x(62), 127);
+  CHECK_EQ((int8_t)reloaded.x(-58), -128);
+  CHECK_EQ((int8_t)reloaded.y(61), -128);
+  CHECK_EQ((int8_t)reloaded.y(-60), 127);
+
+  N64Stick worn(STICK_EEPROM, N64_STICK_SIGNED, true, 80, 3, true);
+  CHECK_EQ(worn.travel(0), 62);
+  CHECK_EQ(worn.travel(1), 58);
+  CHECK_EQ(worn.travel(2), 61);
+  CHECK_EQ(worn.travel(3), 60);
+}
+
+static void test_joybus_crc()
+{
+  CHECK_EQ(JoybusController::addressCrc(0x0000), 0x00);
+  CHECK_EQ(JoybusController::addressCrc(0x8000), RUMBLEPAK_INIT_ADDRESS & 0x1F);
+  CHECK_EQ(JoybusController::addressCrc(0xC000), RUMBLEPAK_CTRL_ADDRESS & 0x1F);
+
+  uint8_t block[32];
+  memset(block, 0, sizeof(block));
+  CHECK_EQ(JoybusController::dataCrc(block), 0x00);
+
+  // The firmware's checksums against the simulated controller's
+  for(uint32_t address = 0; address < 0x10000; address += 0x20)
+    CHECK_EQ(N64Controller::pakAddress(address), address | JoybusController::addressCrc(address));
+
+  for(uint16_t i = 0; i < 1000; i++)
+  {
+    for(uint8_t j = 0; j < sizeof(block); j++)
+      block[j] = random32();
+
+    CHECK_EQ(N64Controller::pakDataCrc(block), JoybusController::dataCrc(block));
+  }
+}
+
+static void test_nes_controller()
+{
+  board.reset();
+  NESController controller;
+  controller.init();
+
+  for(uint16_t pressed = 0; pressed < 256; pressed++)
+  {
+    board.nes.setPressed(pressed);
+    board.powerPadD3.setPressed(pressed ^ 0x5A);
+    board.powerPadD4.setPressed(pressed >> 4);
+
+    NESControllerState state = controller.readController();
+
+    CHECK_EQ(state.standardButtons, pressed);
+    CHECK_EQ(state.powerPadButtons, expand(pressed ^ 0x5A, powerPadD3Bits, 8) | expand(pressed >> 4, powerPadD4Bits, 4));
+  }
+}
+
+static void test_snes_controller()
+{
+  board.reset();
+  SNESController controller;
+  controller.init();
+
+  for(uint16_t pressed = 0; pressed < 4096; pressed++)
+  {
+    board.snes.setPressed(pressed);
+
+    SNESControllerState state = controller.readController();
+
+    CHECK_EQ(state.standardButtons, pressed);
+    CHECK(!state.nttConnected);
+  }
+
+  // noN64 wiring reads the NTT keys from D2 (PD2)
+  for(uint8_t key = 0; key < 16; key++)
+  {
+    board.snes.setPressed(1UL << 13);
+    board.nttD2.setPressed(1UL << (16 + key));
+
+    SNESControllerState state = controller.readController();
+
+    CHECK(state.nttConnected);
+    CHECK_EQ(state.nttKeypad, (key == 14) ? 0 : (1UL << (16 + key)));
+  }
+}
+
+// The Switch sketch's mapping tables (PadTables.h)
+
+// Each source bit may only be in one entry of a PadMap table
+static bool padMapDisjoint(const PadMap *map, uint8_t entries)
+{
+  uint32_t seen = 0;
+
+  for(uint8_t i = 0; i < entries; i++)
+  {
+    if(seen & map[i].from)
+      return false;
+    seen |= map[i].from;
+  }
+
+  return true;
+}
+
+static uint32_t switchHotkeys(uint32_t pad, uint32_t n64State, uint32_t genesis3)
+{
+  uint32_t sources[] = {0, n64State, genesis3};
+  return padHotkeys(pad, sources, HOTKEYS, PAD_ENTRIES(HOTKEYS));
+}
+
+static void test_switch_tables()
+{
+  CHECK(padMapDisjoint(DPAD_MAP, PAD_ENTRIES(DPAD_MAP)));
+  CHECK(padMapDisjoint(NES_MAP, PAD_ENTRIES(NES_MAP)));
+  CHECK(padMapDisjoint(SNES_MAP, PAD_ENTRIES(SNES_MAP)));
+  CHECK(padMapDisjoint(GENESIS_MAP, PAD_ENTRIES(GENESIS_MAP)));
+  CHECK(padMapDisjoint(GENESIS_MAP_SWAPPED, PAD_ENTRIES(GENESIS_MAP_SWAPPED)));
+  CHECK(padMapDisjoint(N64_MAP, PAD_ENTRIES(N64_MAP)));
+  CHECK(padMapDisjoint(N64_MAP_SWAPPED, PAD_ENTRIES(N64_MAP_SWAPPED)));
+  CHECK(padMapDisjoint(SWITCH_MAP, PAD_ENTRIES(SWITCH_MAP)));
+
+  // The swapped layouts index the same way as the ones they replace
+  CHECK_EQ(PAD_ENTRIES(GENESIS_MAP_SWAPPED), PAD_ENTRIES(GENESIS_MAP));
+  CHECK_EQ(PAD_ENTRIES(N64_MAP_SWAPPED), PAD_ENTRIES(N64_MAP));
+
+  // Swap_Gen_Button trades Y and Z, every other Genesis button stays
+  for(uint8_t bit = 0; bit < 16; bit++)
+  {
+    uint32_t button = 1UL << bit;
+    uint32_t normal = padMap(button, GENESIS_MAP, PAD_ENTRIES(GENESIS_MAP));
+    uint32_t swapped = padMap(button, GENESIS_MAP_SWAPPED, PAD_ENTRIES(GENESIS_MAP));
+
+    if(button == SC_BTN_Y)
+      CHECK(normal == PAD(BUTTONX) && swapped == PAD(BUTTONRB));
+    else if(button == SC_BTN_Z)
+      CHECK(normal == PAD(BUTTONRB) && swapped == PAD(BUTTONX));
+    else
+      CHECK_EQ(swapped, normal);
+  }
+
+  // Swap_N64_Button moves B onto X, every other N64 / GameCube button stays
+  for(uint8_t bit = 0; bit < 32; bit++)
+  {
+    uint32_t button = 1UL << bit;
+    uint32_t normal = padMap(button, N64_MAP, PAD_ENTRIES(N64_MAP));
+    uint32_t swapped = padMap(button, N64_MAP_SWAPPED, PAD_ENTRIES(N64_MAP));
+
+    if(button == N64_B)
+      CHECK(normal == PAD(BUTTONB) && swapped == PAD(BUTTONX));
+    else
+      CHECK_EQ(swapped, normal);
+  }
+
+  // N64 hotkeys replace their buttons
+  uint32_t n64 = N64_DOWN | N64_START;
+  CHECK_EQ(switchHotkeys(padMap(n64, N64_MAP, PAD_ENTRIES(N64_MAP)), n64, 0), PAD(BUTTONSELECT));
+  n64 = N64_UP | N64_START;
+  CHECK_EQ(switchHotkeys(padMap(n64, N64_MAP, PAD_ENTRIES(N64_MAP)), n64, 0), PAD(BUTTONCAPTURE));
+  n64 = N64_L | N64_R | N64_START;
+  CHECK_EQ(switchHotkeys(padMap(n64, N64_MAP, PAD_ENTRIES(N64_MAP)), n64, 0), PAD(BUTTONHOME));
+  n64 = N64_RESET;
+  CHECK_EQ(switchHotkeys(0, n64, 0), PAD(BUTTONHOME));
+
+  // Select / Mode combos on the virtual pad, whichever pad they come from
+  uint32_t select = PAD(BUTTONSELECT);
+  CHECK_EQ(switchHotkeys(select | PAD(BUTTONSTART), 0, 0), PAD(BUTTONHOME));
+  CHECK_EQ(switchHotkeys(select | PAD(BUTTONDOWN), 0, 0), PAD(BUTTONLT) | PAD(BUTTONRT));
+  CHECK_EQ(switchHotkeys(select | PAD(BUTTONUP), 0, 0), PAD(BUTTONCAPTURE));
+  CHECK_EQ(switchHotkeys(padMap(SC_BTN_MODE | SC_BTN_START, GENESIS_MAP, PAD_ENTRIES(GENESIS_MAP)), 0, 0),
+           PAD(BUTTONHOME));
+
+  // In order: Select + Start wins and takes Select away from Select + Down
+  CHECK_EQ(switchHotkeys(select | PAD(BUTTONSTART) | PAD(BUTTONDOWN), 0, 0), PAD(BUTTONHOME) | PAD(BUTTONDOWN));
+
+  // The N64 hotkeys run first, the Select of D-Down + Start then meets up
+  // on another pad's D-pad
+  n64 = N64_DOWN | N64_START;
+  CHECK_EQ(switchHotkeys(padMap(n64, N64_MAP, PAD_ENTRIES(N64_MAP)) | PAD(BUTTONUP), n64, 0), PAD(BUTTONCAPTURE));
+
+  // Genesis 3-button pads only
+  uint32_t genesis = SC_BTN_START | SC_BTN_A | SC_BTN_B | SC_BTN_C;
+  uint32_t pad = padMap(genesis, GENESIS_MAP, PAD_ENTRIES(GENESIS_MAP));
+  CHECK_EQ(switchHotkeys(pad, 0, genesis), PAD(BUTTONLT) | PAD(BUTTONRT));
+  CHECK_EQ(switchHotkeys(pad, 0, 0), pad);
+  genesis = SC_BTN_START | SC_BTN_A | SC_BTN_DOWN;
+  CHECK_EQ(switchHotkeys(padMap(genesis, GENESIS_MAP, PAD_ENTRIES(GENESIS_MAP)), 0, genesis), PAD(BUTTONHOME));
+  genesis = SC_BTN_START | SC_BTN_A | SC_BTN_UP;
+  CHECK_EQ(switchHotkeys(padMap(genesis, GENESIS_MAP, PAD_ENTRIES(GENESIS_MAP)), 0, genesis), PAD(BUTTONCAPTURE));
+
+  // Every D-pad combination against the if-ladder DPAD_HAT replaced:
+  // diagonals first, then up, down, left, right
+  for(uint8_t dpad = 0; dpad < 16; dpad++)
+  {
+    bool up = dpad & PAD(BUTTONUP), down = dpad & PAD(BUTTONDOWN);
+    bool left = dpad & PAD(BUTTONLEFT), right = dpad & PAD(BUTTONRIGHT);
+    uint8_t expected;
+
+    if     (up && right)   expected = DPAD_UPRIGHT_MASK_ON;
+    else if(down && right) expected = DPAD_DOWNRIGHT_MASK_ON;
+    else if(down && left)  expected = DPAD_DOWNLEFT_MASK_ON;
+    else if(up && left)    expected = DPAD_UPLEFT_MASK_ON;
+    else if(up)            expected = DPAD_UP_MASK_ON;
+    else if(down)          expected = DPAD_DOWN_MASK_ON;
+    else if(left)          expected = DPAD_LEFT_MASK_ON;
+    else if(right)         expected = DPAD_RIGHT_MASK_ON;
+    else                   expected = DPAD_NOTHING_MASK_ON;
+
+    CHECK_EQ(pgm_read_byte(&DPAD_HAT[dpad]), expected);
+  }
+
+  // The HAT as the left stick, centered when released
+  CHECK_EQ(HAT_STICK_X[DPAD_NOTHING_MASK_ON], 128);
+  CHECK_EQ(HAT_STICK_Y[DPAD_NOTHING_MASK_ON], 128);
+  CHECK(HAT_STICK_X[DPAD_UPRIGHT_MASK_ON] == 255 && HAT_STICK_Y[DPAD_UPRIGHT_MASK_ON] == 0);
+  CHECK(HAT_STICK_X[DPAD_DOWNLEFT_MASK_ON] == 0 && HAT_STICK_Y[DPAD_DOWNLEFT_MASK_ON] == 255);
+}
+
+static const struct
+{
+  const char *name;
+  void (*run)();
+} tests[] =
+{
+  { "scanner_nes",           test_scanner_nes           },
+  { "scanner_powerpad",      test_scanner_powerpad      },
+  { "scanner_snes",          test_scanner_snes          },
+  { "scanner_ntt",           test_scanner_ntt           },
+  { "scanner_split",         test_scanner_split         },
+  { "scanner_edges",         test_scanner_edges         },
+  { "scanner_presence",      test_scanner_presence      },
+  { "scanner_timing",        test_scanner_timing        },
+  { "port_presence",         test_port_presence         },
+  { "press_latch",           test_press_latch           },
+  { "press_latch_loop",      test_press_latch_loop      },
+  { "genesis_three_button",  test_genesis_three_button  },
+  { "genesis_six_button",    test_genesis_six_button    },
+  { "genesis_disconnected",  test_genesis_disconnected  },
+  { "genesis_input_active",  test_genesis_input_active  },
+  { "n64_status",            test_n64_status            },
+  { "n64_disconnected",      test_n64_disconnected      },
+  { "n64_short_reply",       test_n64_short_reply       },
+  { "n64_rumble",            test_n64_rumble            },
+  { "n64_pak_blocks",        test_n64_pak_blocks        },
+  { "gamecube",              test_gamecube              },
+  { "n64_stick_table",       test_n64_stick_table       },
+  { "n64_stick_calibration", test_n64_stick_calibration },
+  { "joybus_crc",            test_joybus_crc            },
+  { "nes_controller",        test_nes_controller        },
+  { "snes_controller",       test_snes_controller       },
+  { "switch_tables",         test_switch_tables         }
+};
+
+int main()
+{
+  for(unsigned i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+  {
+    unsigned before = failures;
+    tests[i].run();
+    printf("%-24s %s\n", tests[i].name, (failures == before) ? "ok" : "FAILED");
+  }
+
+  printf("%u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
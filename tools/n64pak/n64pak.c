@@ -0,0 +1,385 @@
+/*  n64pak.c
+ *
+ *  Dumps and restores the Controller Pak in the N64 port of a 4dapter
+ *  running the HID firmware built with PAK_TRANSFER=true. Talks to the
+ *  vendor interface of PakTransfer.h with libusb control requests and keeps
+ *  PAK_QUEUE_SIZE blocks in flight, so the firmware always has the next
+ *  block to transfer between its controller polls.
+ *
+ *  usage: n64pak dump|restore|verify file.mpk
+ *
+ *  GNU GENERAL PUBLIC LICENSE
+ *  Version 3, 29 June 2007
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <libusb.h>
+
+// Must match PakTransfer.h and N64_Controller.h of the firmware
+#define PAK_INTERFACE_CLASS     0xFF
+#define PAK_INTERFACE_SUBCLASS  0x64
+#define PAK_INTERFACE_PROTOCOL  0x01
+
+#define PAK_REQ_READ            0x01
+#define PAK_REQ_WRITE           0x02
+#define PAK_REQ_RESULT          0x03
+
+#define PAK_STATUS_IDLE         0
+#define PAK_STATUS_BUSY         1
+#define PAK_STATUS_DONE         2
+
+#define PAK_QUEUE_SIZE          4
+
+#define N64_PAK_OK              0
+#define N64_PAK_NO_REPLY        1
+#define N64_PAK_NO_PAK          2
+#define N64_PAK_CRC_ERROR       3
+
+#define BLOCK_SIZE              32
+#define PAK_SIZE                0x8000
+#define BLOCKS                  (PAK_SIZE / BLOCK_SIZE)
+
+#define RESULT_SIZE             (4 + BLOCK_SIZE)
+#define TIMEOUT_MS              1000
+#define BUSY_TIMEOUT_MS         2000  // A block taking longer means the adapter stopped serving the pak
+
+enum
+{
+  MODE_DUMP,
+  MODE_RESTORE,
+  MODE_VERIFY
+};
+
+typedef struct
+{
+  uint8_t  status;
+  uint8_t  result;
+  uint16_t address;
+  uint8_t  data[BLOCK_SIZE];
+} PakResult;
+
+static libusb_device_handle *handle;
+static uint8_t interfaceNumber;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// First interface of any device that looks like the pak interface
+static int openAdapter()
+{
+  libusb_device **list;
+  ssize_t count = libusb_get_device_list(NULL, &list);
+
+  if(count < 0)
+    return (int)count;
+
+  int rc = LIBUSB_ERROR_NOT_FOUND;
+
+  for(ssize_t i = 0; i < count && rc == LIBUSB_ERROR_NOT_FOUND; i++)
+  {
+    struct libusb_config_descriptor *config;
+
+    if(libusb_get_active_config_descriptor(list[i], &config) != 0)
+      continue;
+
+    for(uint8_t j = 0; j < config->bNumInterfaces; j++)
+    {
+      const struct libusb_interface_descriptor *desc = &config->interface[j].altsetting[0];
+
+      if(desc->bInterfaceClass != PAK_INTERFACE_CLASS ||
+         desc->bInterfaceSubClass != PAK_INTERFACE_SUBCLASS ||
+         desc->bInterfaceProtocol != PAK_INTERFACE_PROTOCOL)
+        continue;
+
+      interfaceNumber = desc->bInterfaceNumber;
+      rc = libusb_open(list[i], &handle);
+      break;
+    }
+
+    libusb_free_config_descriptor(config);
+  }
+
+  libusb_free_device_list(list, 1);
+
+  if(rc == 0)
+    rc = libusb_claim_interface(handle, interfaceNumber);
+
+  return rc;
+}
+
+static int queueBlock(int write, uint16_t address, uint8_t *data)
+{
+  uint8_t requestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_INTERFACE;
+
+  return libusb_control_transfer(handle, requestType, write ? PAK_REQ_WRITE : PAK_REQ_READ,
+                                 address, interfaceNumber, data, write ? BLOCK_SIZE : 0, TIMEOUT_MS);
+}
+
+static int fetchResult(PakResult *result)
+{
+  uint8_t requestType = LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_INTERFACE;
+  uint8_t buffer[RESULT_SIZE];
+
+  int rc = libusb_control_transfer(handle, requestType, PAK_REQ_RESULT, 0, interfaceNumber,
+                                   buffer, sizeof(buffer), TIMEOUT_MS);
+  if(rc < 0)
+    return rc;
+  if(rc != sizeof(buffer))
+    return LIBUSB_ERROR_IO;
+
+  result->status  = buffer[0];
+  result->result  = buffer[1];
+  result->address = buffer[2] | (buffer[3] << 8);
+  memcpy(result->data, &buffer[4], BLOCK_SIZE);
+  return 0;
+}
+
+// Collects what an interrupted earlier run left in the adapter's queue
+static int drain()
+{
+  PakResult result;
+  double start = now();
+
+  do
+  {
+    int rc = fetchResult(&result);
+    if(rc < 0)
+      return rc;
+
+    if(now() - start > BUSY_TIMEOUT_MS / 1000.0)
+      return LIBUSB_ERROR_TIMEOUT;
+  } while(result.status != PAK_STATUS_IDLE);
+
+  return 0;
+}
+
+static const char *pakError(uint8_t result)
+{
+  switch(result)
+  {
+    case N64_PAK_NO_REPLY:  return "no N64 controller";
+    case N64_PAK_NO_PAK:    return "no Controller Pak inserted";
+    case N64_PAK_CRC_ERROR: return "transfer corrupted (check the cable)";
+  }
+
+  return "unknown error";
+}
+
+// Reads (dump, verify) or writes (restore) the whole pak, 'image' in/out
+static int transfer(int mode, uint8_t *image)
+{
+  int write = (mode == MODE_RESTORE);
+  unsigned queued = 0;
+  unsigned done = 0;
+  double start = now();
+  double busySince = 0;
+
+  while(done < BLOCKS)
+  {
+    while(queued < BLOCKS && queued - done < PAK_QUEUE_SIZE)
+    {
+      int rc = queueBlock(write, queued * BLOCK_SIZE, &image[queued * BLOCK_SIZE]);
+      if(rc < 0)
+      {
+        fprintf(stderr, "queueing block %u: %s\n", queued, libusb_strerror(rc));
+        return 1;
+      }
+      queued++;
+    }
+
+    PakResult result;
+    int rc = fetchResult(&result);
+    if(rc < 0)
+    {
+      fprintf(stderr, "fetching block %u: %s\n", done, libusb_strerror(rc));
+      return 1;
+    }
+
+    if(result.status == PAK_STATUS_BUSY)
+    {
+      if(busySince == 0)
+        busySince = now();
+      else if(now() - busySince > BUSY_TIMEOUT_MS / 1000.0)
+      {
+        fprintf(stderr, "block %u timed out\n", done);
+        return 1;
+      }
+
+      usleep(200);
+      continue;
+    }
+
+    busySince = 0;
+
+    if(result.status != PAK_STATUS_DONE || result.address != done * BLOCK_SIZE)
+    {
+      fprintf(stderr, "block %u lost, is another n64pak running?\n", done);
+      return 1;
+    }
+
+    if(result.result != N64_PAK_OK)
+    {
+      fprintf(stderr, "block %u at 0x%04X: %s\n", done, result.address, pakError(result.result));
+      return 1;
+    }
+
+    if(mode == MODE_DUMP)
+      memcpy(&image[result.address], result.data, BLOCK_SIZE);
+    else if(mode == MODE_VERIFY && memcmp(&image[result.address], result.data, BLOCK_SIZE) != 0)
+    {
+      fprintf(stderr, "block %u at 0x%04X differs\n", done, result.address);
+      return 1;
+    }
+
+    done++;
+
+    if((done & 63) == 0 || done == BLOCKS)
+    {
+      fprintf(stderr, "\r%s %3u%%", write ? "writing" : "reading", done * 100 / BLOCKS);
+      fflush(stderr);
+    }
+  }
+
+  fprintf(stderr, "  %.1fs\n", now() - start);
+  return 0;
+}
+
+static int loadImage(const char *path, uint8_t *image)
+{
+  FILE *f = fopen(path, "rb");
+  if(!f)
+  {
+    perror(path);
+    return 1;
+  }
+
+  size_t size = fread(image, 1, PAK_SIZE, f);
+  int extra = fgetc(f);
+  fclose(f);
+
+  if(size != PAK_SIZE || extra != EOF)
+  {
+    fprintf(stderr, "%s: not a %u byte Controller Pak image\n", path, PAK_SIZE);
+    return 1;
+  }
+
+  return 0;
+}
+
+static int saveImage(const char *path, const uint8_t *image)
+{
+  FILE *f = fopen(path, "wb");
+  if(!f)
+  {
+    perror(path);
+    return 1;
+  }
+
+  size_t size = fwrite(image, 1, PAK_SIZE, f);
+
+  if(fclose(f) != 0 || size != PAK_SIZE)
+  {
+    perror(path);
+    return 1;
+  }
+
+  return 0;
+}
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: n64pak dump file.mpk      read the Controller Pak into file.mpk\n"
+          "       n64pak restore file.mpk   write file.mpk to the Controller Pak and verify it\n"
+          "       n64pak verify file.mpk    compare the Controller Pak with file.mpk\n");
+}
+
+int main(int argc, char **argv)
+{
+  static uint8_t image[PAK_SIZE];
+  int mode;
+
+  if(argc != 3)
+  {
+    usage();
+    return 2;
+  }
+
+  if(strcmp(argv[1], "dump") == 0)
+    mode = MODE_DUMP;
+  else if(strcmp(argv[1], "restore") == 0)
+    mode = MODE_RESTORE;
+  else if(strcmp(argv[1], "verify") == 0)
+    mode = MODE_VERIFY;
+  else
+  {
+    usage();
+    return 2;
+  }
+
+  if(mode != MODE_DUMP && loadImage(argv[2], image) != 0)
+    return 1;
+
+  int rc = libusb_init(NULL);
+  if(rc < 0)
+  {
+    fprintf(stderr, "libusb: %s\n", libusb_strerror(rc));
+    return 1;
+  }
+
+  rc = openAdapter();
+  if(rc < 0)
+  {
+    fprintf(stderr, "4dapter with PAK_TRANSFER firmware: %s\n", libusb_strerror(rc));
+    libusb_exit(NULL);
+    return 1;
+  }
+
+  int failed = 0;
+
+  rc = drain();
+  if(rc < 0)
+  {
+    fprintf(stderr, "draining the adapter queue: %s\n", libusb_strerror(rc));
+    failed = 1;
+  }
+
+  if(!failed)
+    failed = transfer(mode, image);
+
+  if(!failed && mode == MODE_RESTORE)
+    failed = transfer(MODE_VERIFY, image);
+
+  if(!failed && mode == MODE_DUMP)
+    failed = saveImage(argv[2], image);
+
+  libusb_release_interface(handle, interfaceNumber);
+  libusb_close(handle);
+  libusb_exit(NULL);
+
+  return failed;
+}